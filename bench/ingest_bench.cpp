@@ -0,0 +1,67 @@
+//noa.honigstein@gmail.com
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/MyContainer.hpp"
+#include "../include/IngestBuffer.hpp"
+using namespace container;
+
+// Appends per producer thread in every run.
+static const int kPerThread = 2000000;
+
+/**
+ * @brief Runs body(thread_index) on the given number of threads and returns the elapsed seconds.
+ */
+template<typename Body>
+double timeThreads(int threads, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(body, t);
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::cout << "Appends per thread: " << kPerThread << std::endl;
+    std::cout << "threads | mutex + add() Mops/s | IngestBuffer push() Mops/s | drain ms" << std::endl;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        const double total = static_cast<double>(threads) * kPerThread;
+
+        MyContainer<int> locked;
+        std::mutex lock;
+        double lockedSec = timeThreads(threads, [&](int t) {
+            for (int i = 0; i < kPerThread; ++i) {
+                std::lock_guard<std::mutex> guard(lock);
+                locked.add(t + i);
+            }
+        });
+
+        IngestBuffer<int> buffer;
+        MyContainer<int> target;
+        double bufferSec = timeThreads(threads, [&](int t) {
+            for (int i = 0; i < kPerThread; ++i) {
+                buffer.push(t + i);
+            }
+        });
+        auto drainStart = std::chrono::steady_clock::now();
+        buffer.drain_into(target);
+        double drainMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - drainStart).count();
+
+        std::cout << threads << " | " << total / lockedSec / 1e6 << " | " << total / bufferSec / 1e6
+                  << " | " << drainMs << std::endl;
+        if (target.size() != locked.size()) {
+            std::cerr << "size mismatch" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
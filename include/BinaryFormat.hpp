@@ -0,0 +1,557 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CONTAINER_HAS_MMAP 1
+#else
+#define CONTAINER_HAS_MMAP 0
+#endif
+
+namespace container {
+
+    namespace detail {
+        /**
+         * @brief Read-only view of a whole file: memory-mapped where mmap exists, read into memory otherwise.
+         */
+        class MappedFile {
+            private:
+                void* base = nullptr; ///< Start of the mapping (nullptr for an empty file)
+                size_t length = 0; ///< File size in bytes
+                std::vector<char> fallback; ///< File contents when mmap is unavailable
+
+            public:
+                MappedFile() = default;
+
+                /**
+                 * @brief Opens and maps path.
+                 *
+                 * @param path The file to map
+                 * @param sequential Hint that the file will be read front to back
+                 * @throws std::runtime_error If the file cannot be opened or mapped
+                 */
+                explicit MappedFile(const std::string& path, bool sequential = false) {
+#if CONTAINER_HAS_MMAP
+                    const int fd = ::open(path.c_str(), O_RDONLY);
+                    if (fd < 0) {
+                        throw std::runtime_error("cannot open " + path);
+                    }
+                    struct stat info;
+                    if (::fstat(fd, &info) != 0) {
+                        ::close(fd);
+                        throw std::runtime_error("cannot open " + path);
+                    }
+                    length = static_cast<size_t>(info.st_size);
+                    if (length > 0) {
+                        base = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                    }
+                    ::close(fd);
+                    if (base == MAP_FAILED) {
+                        base = nullptr;
+                        throw std::runtime_error("cannot map " + path);
+                    }
+                    if (base && sequential) {
+                        ::madvise(base, length, MADV_SEQUENTIAL);
+                    }
+#else
+                    (void)sequential;
+                    std::ifstream in(path, std::ios::binary | std::ios::ate);
+                    if (!in) {
+                        throw std::runtime_error("cannot open " + path);
+                    }
+                    fallback.resize(static_cast<size_t>(in.tellg()));
+                    in.seekg(0);
+                    in.read(fallback.data(), static_cast<std::streamsize>(fallback.size()));
+                    length = fallback.size();
+                    base = fallback.empty() ? nullptr : fallback.data();
+#endif
+                }
+
+                MappedFile(const MappedFile&) = delete;
+                MappedFile& operator=(const MappedFile&) = delete;
+
+                MappedFile(MappedFile&& other) noexcept
+                    : base(std::exchange(other.base, nullptr)), length(std::exchange(other.length, 0)),
+                      fallback(std::move(other.fallback)) {}
+
+                MappedFile& operator=(MappedFile&& other) noexcept {
+                    if (this != &other) {
+                        release();
+                        base = std::exchange(other.base, nullptr);
+                        length = std::exchange(other.length, 0);
+                        fallback = std::move(other.fallback);
+                    }
+                    return *this;
+                }
+
+                ~MappedFile() {
+                    release();
+                }
+
+                const char* data() const {
+                    return static_cast<const char*>(base);
+                }
+
+                size_t size() const {
+                    return length;
+                }
+
+            private:
+                void release() {
+#if CONTAINER_HAS_MMAP
+                    if (base) {
+                        ::munmap(base, length);
+                    }
+#endif
+                    base = nullptr;
+                    length = 0;
+                }
+        };
+    }
+
+    /**
+     * @brief The on-disk container format.
+     *
+     * A 32-byte little-endian header followed by the element block:
+     *
+     *     offset  size  field
+     *          0     8  magic "MYCONTNR"
+     *          8     4  format version
+     *         12     4  type tag (TypeTag)
+     *         16     4  element size in bytes (0 for strings)
+     *         20     4  flags (flag_sorted_index)
+     *         24     8  element count
+     *
+     * Trivially copyable elements follow as one raw little-endian block starting at
+     * offset 32, so a mapped file can be read in place. Strings follow as a 64-bit
+     * length and the bytes of each string.
+     *
+     * With flag_sorted_index set, the element block is followed by the ascending
+     * (stable) sort permutation: count indices of 4 bytes (8 bytes when count does not
+     * fit in 32 bits), then a 64-bit checksum of the indices.
+     */
+    namespace binary {
+        inline constexpr char magic[8] = {'M', 'Y', 'C', 'O', 'N', 'T', 'N', 'R'};
+        inline constexpr uint32_t format_version = 1;
+        inline constexpr size_t header_size = 32;
+        inline constexpr uint32_t flag_sorted_index = 1; ///< The sorted permutation follows the elements
+        inline constexpr uint32_t known_flags = flag_sorted_index; ///< Flag bits this version understands
+
+        /**
+         * @brief Identifies the element type stored in a file.
+         */
+        enum class TypeTag : uint32_t {
+            Int8 = 1, UInt8, Int16, UInt16, Int32, UInt32, Int64, UInt64,
+            Float32, Float64,
+            String = 16,
+            Raw = 32 ///< Any other trivially copyable type, checked by element size only
+        };
+
+        template<typename T>
+        constexpr TypeTag type_tag() {
+            if constexpr (std::is_same_v<T, std::string>) {
+                return TypeTag::String;
+            } else if constexpr (std::is_floating_point_v<T> && sizeof(T) == 4) {
+                return TypeTag::Float32;
+            } else if constexpr (std::is_floating_point_v<T> && sizeof(T) == 8) {
+                return TypeTag::Float64;
+            } else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+                constexpr uint32_t base = sizeof(T) == 1 ? 1 : sizeof(T) == 2 ? 3 : sizeof(T) == 4 ? 5 : 7;
+                return static_cast<TypeTag>(base + (std::is_unsigned_v<T> ? 1 : 0));
+            } else {
+                static_assert(std::is_trivially_copyable_v<T>,
+                              "binary format supports trivially copyable types and std::string");
+                return TypeTag::Raw;
+            }
+        }
+
+        /**
+         * @brief Decoded file header.
+         */
+        struct Header {
+            uint32_t version = format_version;
+            TypeTag tag = TypeTag::Raw;
+            uint32_t elementSize = 0;
+            uint32_t flags = 0;
+            uint64_t count = 0;
+        };
+
+        template<typename U>
+        void put_le(unsigned char* out, U value) {
+            for (size_t i = 0; i < sizeof(U); ++i) {
+                out[i] = static_cast<unsigned char>(value >> (8 * i));
+            }
+        }
+
+        template<typename U>
+        U get_le(const unsigned char* in) {
+            U value = 0;
+            for (size_t i = 0; i < sizeof(U); ++i) {
+                value |= static_cast<U>(in[i]) << (8 * i);
+            }
+            return value;
+        }
+
+        inline void write_header(std::ostream& os, const Header& h) {
+            unsigned char bytes[header_size];
+            std::memcpy(bytes, magic, sizeof(magic));
+            put_le<uint32_t>(bytes + 8, h.version);
+            put_le<uint32_t>(bytes + 12, static_cast<uint32_t>(h.tag));
+            put_le<uint32_t>(bytes + 16, h.elementSize);
+            put_le<uint32_t>(bytes + 20, h.flags);
+            put_le<uint64_t>(bytes + 24, h.count);
+            os.write(reinterpret_cast<const char*>(bytes), header_size);
+        }
+
+        /**
+         * @brief Decodes and validates a header for element type T.
+         *
+         * @throws std::runtime_error If the magic, version, type or element size do not match
+         */
+        template<typename T>
+        Header parse_header(const unsigned char* bytes) {
+            if (std::memcmp(bytes, magic, sizeof(magic)) != 0) {
+                throw std::runtime_error("load_binary: not a MyContainer file.");
+            }
+            Header h;
+            h.version = get_le<uint32_t>(bytes + 8);
+            h.tag = static_cast<TypeTag>(get_le<uint32_t>(bytes + 12));
+            h.elementSize = get_le<uint32_t>(bytes + 16);
+            h.flags = get_le<uint32_t>(bytes + 20);
+            h.count = get_le<uint64_t>(bytes + 24);
+            if (h.version != format_version || (h.flags & ~known_flags) != 0) {
+                throw std::runtime_error("load_binary: unsupported format version.");
+            }
+            const uint32_t expectedSize = std::is_same_v<T, std::string> ? 0 : static_cast<uint32_t>(sizeof(T));
+            if (h.tag != type_tag<T>() || h.elementSize != expectedSize) {
+                throw std::runtime_error("load_binary: element type mismatch.");
+            }
+            return h;
+        }
+
+        /**
+         * @brief Reverses the bytes of each element (big-endian hosts only).
+         */
+        template<typename T>
+        void swap_bytes(T* p, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                auto* bytes = reinterpret_cast<unsigned char*>(p + i);
+                std::reverse(bytes, bytes + sizeof(T));
+            }
+        }
+
+        template<typename T>
+        void write_elements(std::ostream& os, std::span<const T> values) {
+            if constexpr (std::is_same_v<T, std::string>) {
+                for (const std::string& s : values) {
+                    unsigned char length[8];
+                    put_le<uint64_t>(length, s.size());
+                    os.write(reinterpret_cast<const char*>(length), sizeof(length));
+                    os.write(s.data(), static_cast<std::streamsize>(s.size()));
+                }
+            } else if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+                os.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+            } else {
+                constexpr size_t block = 4096;
+                std::vector<T> swapped;
+                for (size_t first = 0; first < values.size(); first += block) {
+                    auto part = values.subspan(first, std::min(block, values.size() - first));
+                    swapped.assign(part.begin(), part.end());
+                    swap_bytes(swapped.data(), swapped.size());
+                    os.write(reinterpret_cast<const char*>(swapped.data()), static_cast<std::streamsize>(part.size_bytes()));
+                }
+            }
+        }
+
+        /**
+         * @brief Reads count elements written by write_elements.
+         *
+         * @throws std::runtime_error If the stream ends early
+         */
+        template<typename T>
+        std::vector<T> read_elements(std::istream& is, uint64_t count) {
+            std::vector<T> values;
+            if constexpr (std::is_same_v<T, std::string>) {
+                values.reserve(static_cast<size_t>(std::min<uint64_t>(count, 1 << 20)));
+                for (uint64_t i = 0; i < count; ++i) {
+                    unsigned char length[8];
+                    if (!is.read(reinterpret_cast<char*>(length), sizeof(length))) {
+                        throw std::runtime_error("load_binary: file is truncated.");
+                    }
+                    // the length is untrusted too: read the characters in bounded chunks
+                    const uint64_t size = get_le<uint64_t>(length);
+                    constexpr size_t chunk = size_t{1} << 16;
+                    std::string s;
+                    for (uint64_t done = 0; done < size; ) {
+                        const size_t n = static_cast<size_t>(std::min<uint64_t>(chunk, size - done));
+                        const size_t old = s.size();
+                        s.resize(old + n);
+                        if (!is.read(s.data() + old, static_cast<std::streamsize>(n))) {
+                            throw std::runtime_error("load_binary: file is truncated.");
+                        }
+                        done += n;
+                    }
+                    values.push_back(std::move(s));
+                }
+            } else {
+                // grow in bounded steps so a corrupt count cannot allocate unbounded memory up front
+                constexpr size_t block = size_t{1} << 20;
+                for (uint64_t done = 0; done < count; ) {
+                    const size_t n = static_cast<size_t>(std::min<uint64_t>(block, count - done));
+                    const size_t old = values.size();
+                    values.resize(old + n);
+                    if (!is.read(reinterpret_cast<char*>(values.data() + old), static_cast<std::streamsize>(n * sizeof(T)))) {
+                        throw std::runtime_error("load_binary: file is truncated.");
+                    }
+                    done += n;
+                }
+                if constexpr (std::endian::native != std::endian::little && sizeof(T) > 1) {
+                    swap_bytes(values.data(), values.size());
+                }
+            }
+            return values;
+        }
+
+        /**
+         * @brief Running checksum of the sort permutation (seeded with the element count).
+         */
+        struct IndexChecksum {
+            uint64_t state;
+
+            explicit IndexChecksum(uint64_t count) : state(0x9e3779b97f4a7c15ULL ^ count) {}
+
+            void add(uint64_t index) {
+                state = (state ^ index) * 0x100000001b3ULL;
+                state ^= state >> 29;
+            }
+        };
+
+        inline size_t index_width(uint64_t count) {
+            return count <= UINT32_MAX ? 4 : 8;
+        }
+
+        /**
+         * @brief Writes the stable ascending sort permutation of values and its checksum.
+         */
+        template<typename T>
+        void write_sorted_index(std::ostream& os, std::span<const T> values) {
+            auto writeAs = [&]<typename Index>(Index) {
+                std::vector<Index> order(values.size());
+                if constexpr (std::is_trivially_copyable_v<T>) {
+                    // sorting (value, index) pairs keeps the comparisons in cache; the index breaks ties stably
+                    std::vector<std::pair<T, Index>> keyed(values.size());
+                    for (size_t i = 0; i < keyed.size(); ++i) {
+                        keyed[i] = {values[i], static_cast<Index>(i)};
+                    }
+                    std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) {
+                        return a.first < b.first || (!(b.first < a.first) && a.second < b.second);
+                    });
+                    for (size_t i = 0; i < keyed.size(); ++i) {
+                        order[i] = keyed[i].second;
+                    }
+                } else {
+                    for (size_t i = 0; i < order.size(); ++i) {
+                        order[i] = static_cast<Index>(i);
+                    }
+                    std::stable_sort(order.begin(), order.end(),
+                                     [&values](Index a, Index b) { return values[a] < values[b]; });
+                }
+                IndexChecksum checksum(values.size());
+                constexpr size_t block = 1024;
+                unsigned char bytes[block * sizeof(Index)];
+                for (size_t first = 0; first < order.size(); first += block) {
+                    const size_t n = std::min(block, order.size() - first);
+                    for (size_t i = 0; i < n; ++i) {
+                        put_le<Index>(bytes + i * sizeof(Index), order[first + i]);
+                        checksum.add(order[first + i]);
+                    }
+                    os.write(reinterpret_cast<const char*>(bytes), static_cast<std::streamsize>(n * sizeof(Index)));
+                }
+                unsigned char trailer[8];
+                put_le<uint64_t>(trailer, checksum.state);
+                os.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+            };
+            if (index_width(values.size()) == 4) {
+                writeAs(uint32_t{});
+            } else {
+                writeAs(uint64_t{});
+            }
+        }
+
+        /**
+         * @brief Reads a permutation written by write_sorted_index and applies it to values.
+         *
+         * The checksum only protects the indices, so the result is also verified against
+         * the elements it is applied to: every index must appear once and the gathered
+         * values must be ascending. A file whose elements were changed after saving is
+         * rejected rather than producing a wrong snapshot.
+         *
+         * @return std::vector<T> The values in ascending order
+         * @throws std::runtime_error If the block is truncated, the indices are not a permutation,
+         *         the checksum does not match or the gathered values are out of order
+         */
+        template<typename T>
+        std::vector<T> read_sorted_index(std::istream& is, const std::vector<T>& values) {
+            const size_t width = index_width(values.size());
+            std::vector<T> sorted;
+            sorted.reserve(values.size());
+            IndexChecksum checksum(values.size());
+            std::vector<bool> seen(values.size());
+            constexpr size_t block = 1024;
+            unsigned char bytes[block * 8];
+            size_t indices[block];
+            for (size_t first = 0; first < values.size(); first += block) {
+                const size_t n = std::min(block, values.size() - first);
+                if (!is.read(reinterpret_cast<char*>(bytes), static_cast<std::streamsize>(n * width))) {
+                    throw std::runtime_error("load_binary: file is truncated.");
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    const uint64_t index = width == 4 ? get_le<uint32_t>(bytes + 4 * i) : get_le<uint64_t>(bytes + 8 * i);
+                    if (index >= values.size() || seen[static_cast<size_t>(index)]) {
+                        throw std::runtime_error("load_binary: sorted index is corrupt.");
+                    }
+                    seen[static_cast<size_t>(index)] = true;
+                    checksum.add(index);
+                    indices[i] = static_cast<size_t>(index);
+                }
+                // the gather is random access; prefetching a few elements ahead hides most of the misses
+                constexpr size_t ahead = 16;
+                for (size_t i = 0; i < std::min(ahead, n); ++i) {
+                    __builtin_prefetch(&values[indices[i]]);
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    if (i + ahead < n) {
+                        __builtin_prefetch(&values[indices[i + ahead]]);
+                    }
+                    const T& value = values[indices[i]];
+                    if (!sorted.empty() && value < sorted.back()) {
+                        throw std::runtime_error("load_binary: sorted index is corrupt.");
+                    }
+                    sorted.push_back(value);
+                }
+            }
+            unsigned char trailer[8];
+            if (!is.read(reinterpret_cast<char*>(trailer), sizeof(trailer))) {
+                throw std::runtime_error("load_binary: file is truncated.");
+            }
+            if (get_le<uint64_t>(trailer) != checksum.state) {
+                throw std::runtime_error("load_binary: sorted index is corrupt.");
+            }
+            return sorted;
+        }
+    }
+
+#if CONTAINER_HAS_MMAP
+    /**
+     * @brief Zero-copy, read-only view of a container file saved with save_binary().
+     *
+     * The file is memory-mapped and the elements are read in place: opening costs
+     * O(1) regardless of size and pages are loaded on first touch. Available for
+     * trivially copyable T on little-endian hosts. Copy the elements into a
+     * MyContainer with add_all(as_span()) when they need to be modified.
+     *
+     * @tparam T The element type the file was saved with
+     */
+    template<typename T>
+    class MappedContainer {
+        static_assert(std::is_trivially_copyable_v<T>, "MappedContainer needs a trivially copyable element type");
+        static_assert(std::endian::native == std::endian::little, "MappedContainer reads little-endian files in place");
+
+        private:
+            detail::MappedFile file; ///< The mapping, released on destruction
+            const T* first = nullptr; ///< First element inside the mapping
+            size_t count = 0; ///< Number of elements
+
+        public:
+            /**
+             * @brief Maps a file written by save_binary().
+             *
+             * @param path The file to map
+             * @throws std::runtime_error If the file cannot be mapped or is not a matching container file
+             */
+            explicit MappedContainer(const std::string& path) {
+                try {
+                    file = detail::MappedFile(path);
+                } catch (const std::runtime_error& e) {
+                    throw std::runtime_error(std::string("load_binary: ") + e.what());
+                }
+                if (file.size() < binary::header_size) {
+                    throw std::runtime_error("load_binary: file is truncated.");
+                }
+                const auto* bytes = reinterpret_cast<const unsigned char*>(file.data());
+                binary::Header h = binary::parse_header<T>(bytes);
+                if (h.count > (file.size() - binary::header_size) / sizeof(T)) {
+                    throw std::runtime_error("load_binary: file is truncated.");
+                }
+                count = static_cast<size_t>(h.count);
+                first = reinterpret_cast<const T*>(bytes + binary::header_size);
+            }
+
+            MappedContainer(MappedContainer&& other) noexcept
+                : file(std::move(other.file)), first(std::exchange(other.first, nullptr)),
+                  count(std::exchange(other.count, 0)) {}
+
+            MappedContainer& operator=(MappedContainer&& other) noexcept {
+                if (this != &other) {
+                    file = std::move(other.file);
+                    first = std::exchange(other.first, nullptr);
+                    count = std::exchange(other.count, 0);
+                }
+                return *this;
+            }
+
+            size_t size() const {
+                return count;
+            }
+
+            bool empty() const {
+                return count == 0;
+            }
+
+            /**
+             * @brief Returns the i-th element in insertion order.
+             *
+             * @throws std::out_of_range If i >= size()
+             */
+            const T& operator[](size_t i) const {
+                if (i >= count) {
+                    throw std::out_of_range("MappedContainer index out of range");
+                }
+                return first[i];
+            }
+
+            const T* begin() const {
+                return first;
+            }
+
+            const T* end() const {
+                return first + count;
+            }
+
+            /**
+             * @brief Returns the mapped elements as a span (valid while this object lives).
+             */
+            std::span<const T> as_span() const {
+                return std::span<const T>(first, count);
+            }
+    };
+#endif
+
+}
@@ -0,0 +1,103 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace container {
+
+    /**
+     * @brief Types that std::hash can hash.
+     */
+    template<typename T>
+    concept Hashable = requires(const T& value) {
+        { std::hash<T>{}(value) } -> std::convertible_to<size_t>;
+    };
+
+    namespace detail {
+        /**
+         * @brief std::hash of value with its bits spread (identity hashes of integers are not).
+         */
+        template<Hashable T>
+        uint64_t mixed_hash(const T& value) {
+            uint64_t h = static_cast<uint64_t>(std::hash<T>{}(value));
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+    }
+
+    /**
+     * @brief Bloom filter: a set summary with no false negatives.
+     *
+     * might_contain() is false only for values that were never inserted, and true for
+     * an absent value with probability close to the false-positive rate it was sized for.
+     * The probe positions come from one 64-bit hash by double hashing.
+     *
+     * @tparam T The value type (must be Hashable to insert or query)
+     */
+    template<typename T>
+    class BloomFilter {
+        private:
+            std::vector<uint64_t> words; ///< The bit array
+            size_t bits; ///< Number of bits in the array
+            unsigned probes; ///< Bits set per value
+
+        public:
+            /**
+             * @brief Sizes the filter for an expected number of values and false-positive rate.
+             *
+             * @param expected Number of values the rate is guaranteed for
+             * @param falsePositiveRate Target rate for absent values, in (0, 1)
+             */
+            explicit BloomFilter(size_t expected = 1024, double falsePositiveRate = 0.01) {
+                const double n = static_cast<double>(std::max<size_t>(expected, 1));
+                const double p = std::clamp(falsePositiveRate, 1e-9, 0.5);
+                const double ln2 = std::log(2.0);
+                bits = std::max<size_t>(64, static_cast<size_t>(std::ceil(-n * std::log(p) / (ln2 * ln2))));
+                probes = std::max(1u, static_cast<unsigned>(std::round(static_cast<double>(bits) / n * ln2)));
+                words.assign((bits + 63) / 64, 0);
+            }
+
+            void insert(const T& value) {
+                const uint64_t h = detail::mixed_hash(value);
+                const uint64_t step = (h >> 32) | 1;
+                uint64_t probe = h;
+                for (unsigned i = 0; i < probes; ++i, probe += step) {
+                    const size_t bit = static_cast<size_t>(probe % bits);
+                    words[bit / 64] |= uint64_t{1} << (bit % 64);
+                }
+            }
+
+            /**
+             * @brief Returns false if value was certainly never inserted.
+             */
+            bool might_contain(const T& value) const {
+                const uint64_t h = detail::mixed_hash(value);
+                const uint64_t step = (h >> 32) | 1;
+                uint64_t probe = h;
+                for (unsigned i = 0; i < probes; ++i, probe += step) {
+                    const size_t bit = static_cast<size_t>(probe % bits);
+                    if ((words[bit / 64] & (uint64_t{1} << (bit % 64))) == 0) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            /**
+             * @brief Returns the size of the bit array in bytes.
+             */
+            size_t memory_bytes() const {
+                return words.size() * sizeof(uint64_t);
+            }
+    };
+
+}
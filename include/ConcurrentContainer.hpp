@@ -0,0 +1,256 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include "MyContainer.hpp"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace container {
+
+    /**
+     * @brief A thread-safe counterpart of MyContainer with lock-free snapshot reads.
+     *
+     * Elements live in fixed-capacity chunks that are never reallocated. A writer
+     * constructs new elements only in slots beyond the published size, then publishes
+     * an immutable State (chunk table + element count) through an atomic shared_ptr.
+     * Readers take a Snapshot by loading that pointer once and then iterate without any
+     * lock: the slots they can see are never written again, so they never observe a torn
+     * state, while writers keep appending behind them. Memory is reclaimed by reference
+     * counting once the last snapshot holding a chunk is released.
+     *
+     * Writers (add, remove) serialize among themselves on a mutex; readers never take it.
+     *
+     * @tparam T The type of elements to store (defaults to int)
+     */
+    template<typename T = int>
+    class ConcurrentContainer {
+        public:
+            static constexpr size_t chunk_size = 4096; ///< Elements per storage chunk
+
+        private:
+            /**
+             * @brief Fixed-capacity block of element slots.
+             *
+             * Slots [0, constructed) hold live elements; the chunk never moves them.
+             */
+            struct Chunk {
+                T* slots; ///< Raw storage for chunk_size elements
+                size_t constructed; ///< Number of constructed slots (touched by the writer only)
+
+                Chunk() : slots(std::allocator<T>().allocate(chunk_size)), constructed(0) {}
+
+                Chunk(const Chunk&) = delete;
+                Chunk& operator=(const Chunk&) = delete;
+
+                ~Chunk() {
+                    std::destroy_n(slots, constructed);
+                    std::allocator<T>().deallocate(slots, chunk_size);
+                }
+            };
+
+            using ChunkTable = std::vector<std::shared_ptr<Chunk>>;
+
+            /**
+             * @brief Immutable published view: which chunks exist and how many elements are visible.
+             */
+            struct State {
+                std::shared_ptr<const ChunkTable> chunks; ///< Chunk table shared between states
+                size_t count; ///< Number of visible elements
+            };
+
+            std::atomic<std::shared_ptr<const State>> current; ///< Latest published state
+            std::mutex writeMutex; ///< Serializes writers
+
+            /**
+             * @brief Constructs value in the next free slot after the latest state (writer lock held).
+             *
+             * @return std::shared_ptr<const ChunkTable> The chunk table to publish with the new count
+             */
+            static std::shared_ptr<const ChunkTable> appendSlot(const State& state, const T& value) {
+                std::shared_ptr<const ChunkTable> chunks = state.chunks;
+                if (state.count == chunks->size() * chunk_size) {
+                    auto grown = std::make_shared<ChunkTable>(*chunks);
+                    grown->push_back(std::make_shared<Chunk>());
+                    chunks = std::move(grown);
+                }
+                Chunk& tail = *(*chunks)[state.count / chunk_size];
+                const size_t slot = state.count % chunk_size;
+                if (tail.constructed > slot) { // leftovers of a batch that threw before publishing
+                    std::destroy(tail.slots + slot, tail.slots + tail.constructed);
+                    tail.constructed = slot;
+                }
+                std::construct_at(tail.slots + slot, value);
+                ++tail.constructed;
+                return chunks;
+            }
+
+        public:
+            /**
+             * @brief Immutable, lock-free view of the container at one point in time.
+             *
+             * Holding a snapshot keeps its chunks alive; later writes are not visible to it.
+             */
+            class Snapshot {
+                private:
+                    std::shared_ptr<const State> state; ///< The state captured at creation
+
+                public:
+                    explicit Snapshot(std::shared_ptr<const State> s) : state(std::move(s)) {}
+
+                    /**
+                     * @brief Returns the number of elements in the snapshot.
+                     */
+                    size_t size() const {
+                        return state->count;
+                    }
+
+                    /**
+                     * @brief Returns the i-th element in insertion order.
+                     *
+                     * @throws std::out_of_range If i >= size()
+                     */
+                    const T& operator[](size_t i) const {
+                        if (i >= state->count) {
+                            throw std::out_of_range("Snapshot index out of range");
+                        }
+                        return (*state->chunks)[i / chunk_size]->slots[i % chunk_size];
+                    }
+
+                    /**
+                     * @brief Calls fn(const T*, size_t) once per contiguous block, in insertion order.
+                     */
+                    template<typename Fn>
+                    void for_each_block(Fn&& fn) const {
+                        for (size_t first = 0; first < state->count; first += chunk_size) {
+                            fn(static_cast<const T*>((*state->chunks)[first / chunk_size]->slots),
+                               std::min(chunk_size, state->count - first));
+                        }
+                    }
+
+                    /**
+                     * @brief Copies the snapshot into a vector in insertion order.
+                     */
+                    std::vector<T> to_vector() const {
+                        std::vector<T> out;
+                        out.reserve(state->count);
+                        for_each_block([&out](const T* p, size_t n) { out.insert(out.end(), p, p + n); });
+                        return out;
+                    }
+
+                    /**
+                     * @brief Calls fn on every element in the order chosen at compile time.
+                     *
+                     * Normal and Reverse walk the chunks directly. The other orders first gather
+                     * the elements into one contiguous buffer (sorted for sorted orders) and then
+                     * run the same specialized loops as MyContainer::visit.
+                     */
+                    template<Order O, typename Fn>
+                    void visit(Fn&& fn) const {
+                        if constexpr (O == Order::Normal) {
+                            for_each_block([&fn](const T* p, size_t n) { detail::visit_range<Order::Normal>(p, n, fn); });
+                        } else if constexpr (O == Order::Reverse) {
+                            for (size_t end = state->count; end > 0; ) {
+                                const size_t first = (end - 1) / chunk_size * chunk_size;
+                                detail::visit_range<Order::Reverse>(
+                                    static_cast<const T*>((*state->chunks)[first / chunk_size]->slots), end - first, fn);
+                                end = first;
+                            }
+                        } else {
+                            std::vector<T> gathered = to_vector();
+                            if constexpr (O != Order::MiddleOut) {
+                                std::sort(gathered.begin(), gathered.end());
+                            }
+                            detail::visit_range<O>(gathered.data(), gathered.size(), fn);
+                        }
+                    }
+            };
+
+            /**
+             * @brief Creates an empty container.
+             */
+            ConcurrentContainer()
+                : current(std::make_shared<const State>(State{std::make_shared<const ChunkTable>(), 0})) {}
+
+            ConcurrentContainer(const ConcurrentContainer&) = delete;
+            ConcurrentContainer& operator=(const ConcurrentContainer&) = delete;
+
+            /**
+             * @brief Appends an element and publishes it to new snapshots.
+             *
+             * @param value The value to add
+             */
+            void add(const T& value) {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                std::shared_ptr<const State> state = current.load(std::memory_order_acquire);
+                auto chunks = appendSlot(*state, value);
+                current.store(std::make_shared<const State>(State{std::move(chunks), state->count + 1}),
+                              std::memory_order_release);
+            }
+
+            /**
+             * @brief Appends a batch of elements and publishes them with a single state update.
+             *
+             * @param values The values to add, in order
+             */
+            void add_all(std::span<const T> values) {
+                if (values.empty()) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(writeMutex);
+                std::shared_ptr<const State> state = current.load(std::memory_order_acquire);
+                State next{state->chunks, state->count};
+                for (const T& value : values) {
+                    next.chunks = appendSlot(next, value);
+                    ++next.count;
+                }
+                current.store(std::make_shared<const State>(std::move(next)), std::memory_order_release);
+            }
+
+            /**
+             * @brief Removes all occurrences of a value.
+             *
+             * Builds fresh chunks holding the surviving elements and publishes them in one
+             * step; snapshots taken earlier keep seeing the old contents.
+             *
+             * @param value The value to remove
+             * @throws std::runtime_error If the element is not found in the container
+             */
+            void remove(const T& value) {
+                std::lock_guard<std::mutex> lock(writeMutex);
+                std::shared_ptr<const State> state = current.load(std::memory_order_acquire);
+                State rebuilt{std::make_shared<const ChunkTable>(), 0};
+                bool found = false;
+                Snapshot(state).for_each_block([&](const T* p, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        if (p[i] == value) {
+                            found = true;
+                        } else {
+                            rebuilt.chunks = appendSlot(rebuilt, p[i]);
+                            ++rebuilt.count;
+                        }
+                    }
+                });
+                if (!found) {
+                    throw std::runtime_error("Element not found in container.");
+                }
+                current.store(std::make_shared<const State>(std::move(rebuilt)), std::memory_order_release);
+            }
+
+            /**
+             * @brief Returns the number of published elements.
+             */
+            size_t size() const {
+                return current.load(std::memory_order_acquire)->count;
+            }
+
+            /**
+             * @brief Takes an immutable snapshot for lock-free reading.
+             *
+             * @return Snapshot View of every element published so far
+             */
+            Snapshot snapshot() const {
+                return Snapshot(current.load(std::memory_order_acquire));
+            }
+    };
+
+}
@@ -0,0 +1,175 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include "MyContainer.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace container {
+
+    /**
+     * @brief Lock-free multi-producer ingest buffer that publishes into a container in batches.
+     *
+     * Every producer thread gets its own lane, a single-producer list of fixed-capacity
+     * segments. push() writes the element into the lane's tail segment and release-stores
+     * the segment's written count, so producers never share a cache line or a lock on the
+     * hot path and append throughput scales with the number of threads. The only lock is
+     * taken when a thread first pushes into a buffer (or switches between buffers).
+     *
+     * drain_into() moves everything written so far into a target container with one
+     * add_all() call. Elements from one producer keep their relative order; elements from
+     * different producers are interleaved lane by lane.
+     *
+     * Any number of threads may push concurrently. drain_into() calls are serialized
+     * with each other and only ever block a thread that is registering its lane.
+     *
+     * @tparam T The type of elements to buffer (defaults to int)
+     */
+    template<typename T = int>
+    class IngestBuffer {
+        public:
+            static constexpr size_t segment_size = 1024; ///< Elements per lane segment
+
+        private:
+            /**
+             * @brief Fixed-capacity block of slots written by one producer and read by the drainer.
+             */
+            struct Segment {
+                T* slots; ///< Raw storage for segment_size elements
+                std::atomic<size_t> written; ///< Slots [0, written) are constructed and visible
+                std::atomic<Segment*> next; ///< Following segment, set once by the producer
+
+                Segment() : slots(std::allocator<T>().allocate(segment_size)), written(0), next(nullptr) {}
+
+                ~Segment() {
+                    std::allocator<T>().deallocate(slots, segment_size);
+                }
+            };
+
+            /**
+             * @brief Per-thread single-producer segment list.
+             */
+            struct Lane {
+                Segment* tail; ///< Segment the producer writes to (producer only)
+                Segment* head; ///< Segment the drainer reads from (drainer only)
+                size_t readPos; ///< Next unread slot in head (drainer only)
+
+                Lane() : tail(new Segment()), head(tail), readPos(0) {}
+
+                ~Lane() {
+                    // unread elements are still constructed; everything before readPos was destroyed by the drainer
+                    for (Segment* seg = head; seg != nullptr; ) {
+                        size_t first = seg == head ? readPos : 0;
+                        std::destroy(seg->slots + first, seg->slots + seg->written.load(std::memory_order_acquire));
+                        Segment* next = seg->next.load(std::memory_order_acquire);
+                        delete seg;
+                        seg = next;
+                    }
+                }
+            };
+
+            const uint64_t id; ///< Process-unique id used by the per-thread lane cache
+            std::mutex laneMutex; ///< Guards lanes during registration and draining
+            std::vector<std::unique_ptr<Lane>> lanes; ///< One lane per producer thread
+            std::unordered_map<std::thread::id, Lane*> laneOf; ///< Lane of each registered thread
+            std::mutex drainMutex; ///< Serializes drain_into calls
+
+            static uint64_t nextId() {
+                static std::atomic<uint64_t> counter{1};
+                return counter.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Returns the calling thread's lane, registering it on first use.
+             */
+            Lane& myLane() {
+                struct Cache {
+                    uint64_t owner = 0;
+                    Lane* lane = nullptr;
+                };
+                thread_local Cache cache;
+                if (cache.owner != id) { // first push here, or the thread switched buffers
+                    std::lock_guard<std::mutex> lock(laneMutex);
+                    Lane*& lane = laneOf[std::this_thread::get_id()];
+                    if (lane == nullptr) {
+                        lanes.push_back(std::make_unique<Lane>());
+                        lane = lanes.back().get();
+                    }
+                    cache.owner = id;
+                    cache.lane = lane;
+                }
+                return *cache.lane;
+            }
+
+        public:
+            IngestBuffer() : id(nextId()) {}
+
+            IngestBuffer(const IngestBuffer&) = delete;
+            IngestBuffer& operator=(const IngestBuffer&) = delete;
+
+            /**
+             * @brief Appends an element from the calling thread without taking a lock.
+             *
+             * @param value The value to buffer
+             */
+            void push(const T& value) {
+                Lane& lane = myLane();
+                Segment* seg = lane.tail;
+                size_t w = seg->written.load(std::memory_order_relaxed);
+                if (w == segment_size) {
+                    Segment* fresh = new Segment();
+                    seg->next.store(fresh, std::memory_order_release);
+                    lane.tail = seg = fresh;
+                    w = 0;
+                }
+                std::construct_at(seg->slots + w, value);
+                seg->written.store(w + 1, std::memory_order_release);
+            }
+
+            /**
+             * @brief Moves every element pushed so far into target with a single add_all() call.
+             *
+             * Works with any target providing add_all(std::span<const T>), such as
+             * MyContainer and ConcurrentContainer.
+             *
+             * @param target The container receiving the batch
+             * @return size_t Number of elements published
+             */
+            template<typename Target>
+            size_t drain_into(Target& target) {
+                std::lock_guard<std::mutex> drainLock(drainMutex);
+                std::vector<T> batch;
+                {
+                    std::lock_guard<std::mutex> lock(laneMutex);
+                    for (auto& lanePtr : lanes) {
+                        Lane& lane = *lanePtr;
+                        while (true) {
+                            Segment* seg = lane.head;
+                            const size_t w = seg->written.load(std::memory_order_acquire);
+                            for (size_t i = lane.readPos; i < w; ++i) {
+                                batch.push_back(std::move(seg->slots[i]));
+                                std::destroy_at(seg->slots + i);
+                            }
+                            lane.readPos = w;
+                            Segment* next = w == segment_size ? seg->next.load(std::memory_order_acquire) : nullptr;
+                            if (next == nullptr) {
+                                break;
+                            }
+                            // the producer linked a successor, so it will never touch seg again
+                            lane.head = next;
+                            lane.readPos = 0;
+                            delete seg;
+                        }
+                    }
+                }
+                if (!batch.empty()) {
+                    target.add_all(std::span<const T>(batch));
+                }
+                return batch.size();
+            }
+    };
+
+}
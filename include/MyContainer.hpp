@@ -4,80 +4,2286 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <locale>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#endif
+#include "BinaryFormat.hpp"
+#include "BloomFilter.hpp"
+#include "HyperLogLog.hpp"
+#include "QuantileSketch.hpp"
+#include "SimdScan.hpp"
 
 namespace container {
 
+    /**
+     * @brief The six traversal orders supported by MyContainer.
+     *
+     * Used as a compile-time tag for MyContainer::visit so generic code can pick
+     * the order with a template argument instead of calling different begin_* functions.
+     */
+    enum class Order {
+        Ascending,  ///< Sorted, smallest to largest
+        Descending, ///< Sorted, largest to smallest
+        SideCross,  ///< Smallest, largest, second smallest, second largest, ...
+        Reverse,    ///< Reverse insertion order
+        Normal,     ///< Insertion order
+        MiddleOut   ///< Middle element first, then alternately left and right
+    };
+
+    /**
+     * @brief Parses an order name such as one read from a configuration file.
+     *
+     * Accepted names: "ascending", "descending", "side_cross", "reverse", "normal", "middle_out".
+     *
+     * @param name The order name
+     * @return Order The matching order
+     * @throws std::invalid_argument If the name does not match any order
+     */
+    inline Order order_from_string(const std::string& name) {
+        if (name == "ascending") return Order::Ascending;
+        if (name == "descending") return Order::Descending;
+        if (name == "side_cross") return Order::SideCross;
+        if (name == "reverse") return Order::Reverse;
+        if (name == "normal") return Order::Normal;
+        if (name == "middle_out") return Order::MiddleOut;
+        throw std::invalid_argument("Unknown order name: " + name);
+    }
+
+    /**
+     * @brief Built-in example generator: interleaved strides of width K.
+     *
+     * Visits indices 0, K, 2K, ..., then 1, K+1, 2K+1, ..., and so on for every residue.
+     *
+     * @tparam K The stride (must be at least 1)
+     */
+    template<size_t K>
+    struct StrideOrder {
+        static_assert(K > 0, "StrideOrder requires a positive stride");
+
+        static size_t index(size_t pos, size_t n) {
+            const size_t q = n / K;   // elements in every residue class
+            const size_t rem = n % K; // residue classes holding one extra element
+            const size_t longPart = rem * (q + 1);
+            if (pos < longPart) {
+                return pos / (q + 1) + (pos % (q + 1)) * K;
+            }
+            const size_t p = pos - longPart;
+            return rem + p / q + (p % q) * K;
+        }
+    };
+
+    /**
+     * @brief Built-in example generator: zig-zag over the sorted data in blocks of K.
+     *
+     * Even blocks are visited ascending and odd blocks descending.
+     *
+     * @tparam K The block length (must be at least 1)
+     */
+    template<size_t K>
+    struct ZigZagOrder {
+        static_assert(K > 0, "ZigZagOrder requires a positive block length");
+        static constexpr bool sorted = true; ///< Applied to the ascending sorted data
+
+        static size_t index(size_t pos, size_t n) {
+            const size_t block = pos / K;
+            const size_t start = block * K;
+            const size_t len = std::min(K, n - start);
+            const size_t offset = pos - start;
+            return (block & 1) ? start + len - 1 - offset : start + offset;
+        }
+    };
+
+    /**
+     * @brief Read-only view of a contiguous sequence in reverse order.
+     *
+     * A span-like view over the same memory: element 0 is the last element of the
+     * underlying storage. No data is copied; base() gives the forward span for
+     * routines that take a pointer and walk it with a negative stride themselves.
+     *
+     * @tparam T The element type
+     */
+    template<typename T>
+    class ReverseSpan {
+        private:
+            std::span<const T> forward; ///< The underlying storage in forward order
+
+        public:
+            using iterator = std::reverse_iterator<const T*>;
+
+            ReverseSpan() = default;
+
+            explicit ReverseSpan(std::span<const T> s) : forward(s) {}
+
+            size_t size() const {
+                return forward.size();
+            }
+
+            bool empty() const {
+                return forward.empty();
+            }
+
+            /**
+             * @brief Returns the i-th element in reverse order (unchecked, like std::span).
+             */
+            const T& operator[](size_t i) const {
+                return forward[forward.size() - 1 - i];
+            }
+
+            iterator begin() const {
+                return iterator(forward.data() + forward.size());
+            }
+
+            iterator end() const {
+                return iterator(forward.data());
+            }
+
+            /**
+             * @brief Returns the underlying storage in forward order.
+             */
+            std::span<const T> base() const {
+                return forward;
+            }
+    };
+
+    /**
+     * @brief Read-only view of a contiguous slice of a sorted snapshot.
+     *
+     * Holds a reference to the snapshot, so the slice stays valid after the container
+     * it came from is modified or destroyed.
+     *
+     * @tparam T The element type
+     */
+    template<typename T>
+    class SortedRange {
+        private:
+            std::shared_ptr<const std::vector<T>> snapshot; ///< The sorted snapshot the slice points into
+            const T* first = nullptr; ///< First element of the slice
+            size_t count = 0; ///< Number of elements in the slice
+
+        public:
+            using iterator = const T*;
+
+            SortedRange() = default;
+
+            SortedRange(std::shared_ptr<const std::vector<T>> sorted, size_t offset, size_t n)
+                : snapshot(std::move(sorted)), first(snapshot->data() + offset), count(n) {}
+
+            size_t size() const {
+                return count;
+            }
+
+            bool empty() const {
+                return count == 0;
+            }
+
+            /**
+             * @brief Returns the i-th element of the slice (unchecked, like std::span).
+             */
+            const T& operator[](size_t i) const {
+                return first[i];
+            }
+
+            iterator begin() const {
+                return first;
+            }
+
+            iterator end() const {
+                return first + count;
+            }
+
+            /**
+             * @brief Returns the slice as a span.
+             */
+            std::span<const T> as_span() const {
+                return std::span<const T>(first, count);
+            }
+    };
+
+    namespace detail {
+        /**
+         * @brief Accumulator for sums of T: long double/double for floating T, a 64-bit integer otherwise.
+         */
+        template<typename T>
+        struct sum_type_of {
+            using type = std::conditional_t<std::is_signed_v<T>, long long, unsigned long long>;
+        };
+
+        template<>
+        struct sum_type_of<float> {
+            using type = double;
+        };
+
+        template<>
+        struct sum_type_of<double> {
+            using type = double;
+        };
+
+        template<>
+        struct sum_type_of<long double> {
+            using type = long double;
+        };
+
+        /**
+         * @brief True when generator G declares `static constexpr bool sorted = true`.
+         */
+        template<typename G, typename = void>
+        struct uses_sorted_data : std::false_type {};
+
+        template<typename G>
+        struct uses_sorted_data<G, std::void_t<decltype(G::sorted)>> : std::bool_constant<G::sorted> {};
+
+        /**
+         * @brief Maps a traversal position to an index of the underlying sequence for order O.
+         *
+         * For sorted orders the sequence is the ascending sorted data.
+         *
+         * @param pos Position in the traversal (0 <= pos < n)
+         * @param n Number of elements
+         * @return size_t Index of the element visited at position pos
+         */
+        template<Order O>
+        inline size_t index_at(size_t pos, size_t n) {
+            if constexpr (O == Order::Normal || O == Order::Ascending) {
+                return pos;
+            } else if constexpr (O == Order::Reverse || O == Order::Descending) {
+                return n - 1 - pos;
+            } else if constexpr (O == Order::SideCross) {
+                const size_t k = pos / 2;
+                return (pos & 1) ? n - 1 - k : k;
+            } else {
+                static_assert(O == Order::MiddleOut, "unhandled Order");
+                const size_t mid = n / 2;
+                return (pos & 1) ? mid - (pos + 1) / 2 : mid + pos / 2;
+            }
+        }
+
+        /**
+         * @brief Runs the specialized loop of order O over a contiguous buffer.
+         *
+         * For sorted orders the buffer must already be sorted in ascending order.
+         *
+         * @param p Pointer to the first element
+         * @param n Number of elements
+         * @param fn The visitor to call for each element
+         */
+        template<Order O, typename T, typename Fn>
+        void visit_range(const T* p, size_t n, Fn& fn) {
+            if constexpr (O == Order::Normal || O == Order::Ascending) {
+                for (size_t i = 0; i < n; ++i) {
+                    fn(p[i]);
+                }
+            } else if constexpr (O == Order::Reverse || O == Order::Descending) {
+                for (size_t i = n; i > 0; --i) {
+                    fn(p[i - 1]);
+                }
+            } else if constexpr (O == Order::SideCross) {
+                // pairs (smallest, largest) from the outside in, odd middle element last
+                const size_t half = n / 2;
+                for (size_t k = 0; k < half; ++k) {
+                    fn(p[k]);
+                    fn(p[n - 1 - k]);
+                }
+                if (n % 2 == 1) {
+                    fn(p[half]);
+                }
+            } else {
+                static_assert(O == Order::MiddleOut, "unhandled Order");
+                if (n == 0) {
+                    return;
+                }
+                // middle, then pairs (left, right) moving outward; even sizes end on index 0
+                const size_t mid = n / 2;
+                fn(p[mid]);
+                const size_t pairs = (n - 1) / 2;
+                for (size_t k = 1; k <= pairs; ++k) {
+                    fn(p[mid - k]);
+                    fn(p[mid + k]);
+                }
+                if (n % 2 == 0) {
+                    fn(p[0]);
+                }
+            }
+        }
+
+        /**
+         * @brief Mutex for caches that const methods rebuild lazily; copies get their own unlocked mutex.
+         */
+        struct CacheMutex {
+            std::mutex m;
+
+            CacheMutex() = default;
+            CacheMutex(const CacheMutex&) {}
+            CacheMutex& operator=(const CacheMutex&) {
+                return *this;
+            }
+        };
+
+        /**
+         * @brief True for numbers std::to_chars prints the way std::ostream does (not bool or characters).
+         */
+        template<typename T>
+        inline constexpr bool to_chars_number = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>
+            && !std::is_same_v<T, char> && !std::is_same_v<T, signed char> && !std::is_same_v<T, unsigned char>
+            && !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t>
+            && !std::is_same_v<T, char32_t>;
+
+        /**
+         * @brief Formats values into a 64 KB buffer and hands it to sink(const char*, size_t) in large chunks.
+         *
+         * Numbers go through std::to_chars (floating point as %g with the given precision,
+         * which is what std::ostream prints by default), strings are copied, and any other
+         * type is formatted with its operator<<.
+         */
+        template<typename Sink>
+        class ChunkedWriter {
+            private:
+                static constexpr size_t capacity = size_t{1} << 16;
+                static constexpr size_t max_number = 64; ///< Upper bound on one formatted number
+
+                Sink& sink; ///< Receives each full buffer
+                std::unique_ptr<char[]> buffer; ///< Pending output
+                size_t used = 0; ///< Bytes of buffer in use
+                int precision; ///< Significant digits for floating point
+
+            public:
+                ChunkedWriter(Sink& s, int digits) : sink(s), buffer(new char[capacity]), precision(digits) {}
+
+                void append(const char* p, size_t n) {
+                    if (n > capacity - used) {
+                        flush();
+                        if (n > capacity) {
+                            sink(p, n);
+                            return;
+                        }
+                    }
+                    std::memcpy(buffer.get() + used, p, n);
+                    used += n;
+                }
+
+                template<typename T>
+                void append_value(const T& value) {
+                    if constexpr (to_chars_number<T>) {
+                        if (capacity - used < max_number) {
+                            flush();
+                        }
+                        char* first = buffer.get() + used;
+                        std::to_chars_result r;
+                        if constexpr (std::is_floating_point_v<T>) {
+                            r = std::to_chars(first, buffer.get() + capacity, value, std::chars_format::general, precision);
+                        } else {
+                            r = std::to_chars(first, buffer.get() + capacity, value);
+                        }
+                        used = static_cast<size_t>(r.ptr - buffer.get());
+                    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+                        std::string_view text = value;
+                        append(text.data(), text.size());
+                    } else {
+                        std::ostringstream text;
+                        text.precision(precision);
+                        text << value;
+                        const std::string formatted = text.str();
+                        append(formatted.data(), formatted.size());
+                    }
+                }
+
+                void flush() {
+                    if (used > 0) {
+                        sink(static_cast<const char*>(buffer.get()), used);
+                        used = 0;
+                    }
+                }
+        };
+
+        /**
+         * @brief Appends the k-way merge of ascending runs to out (stable: ties keep run order).
+         *
+         * Two runs use std::merge. More runs go through a loser tree: each internal node
+         * remembers the loser of its match, so after the winner is emitted only the
+         * log2(k) matches on its leaf-to-root path are replayed.
+         */
+        template<typename T>
+        void merge_runs(const std::vector<std::span<const T>>& runs, std::vector<T>& out) {
+            const size_t k = runs.size();
+            if (k == 0) {
+                return;
+            }
+            if (k == 2) {
+                std::merge(runs[0].begin(), runs[0].end(), runs[1].begin(), runs[1].end(), std::back_inserter(out));
+                return;
+            }
+            std::vector<size_t> pos(k, 0);
+            auto exhausted = [&](size_t s) { return s >= k || pos[s] >= runs[s].size(); };
+            auto beats = [&](size_t a, size_t b) {
+                if (exhausted(a)) {
+                    return false;
+                }
+                if (exhausted(b)) {
+                    return true;
+                }
+                const T& x = runs[a][pos[a]];
+                const T& y = runs[b][pos[b]];
+                return x < y || (!(y < x) && a < b);
+            };
+            size_t leaves = 1;
+            while (leaves < k) {
+                leaves *= 2;
+            }
+            // tree[0] is the overall winner, tree[1..leaves) the loser at each internal node
+            std::vector<size_t> tree(leaves);
+            std::vector<size_t> winner(2 * leaves);
+            for (size_t i = 0; i < leaves; ++i) {
+                winner[leaves + i] = i;
+            }
+            for (size_t node = leaves - 1; node >= 1; --node) {
+                const size_t a = winner[2 * node];
+                const size_t b = winner[2 * node + 1];
+                winner[node] = beats(a, b) ? a : b;
+                tree[node] = beats(a, b) ? b : a;
+            }
+            tree[0] = winner[1];
+            while (!exhausted(tree[0])) {
+                size_t w = tree[0];
+                out.push_back(runs[w][pos[w]++]);
+                for (size_t node = (leaves + w) / 2; node >= 1; node /= 2) {
+                    if (beats(tree[node], w)) {
+                        std::swap(tree[node], w);
+                    }
+                }
+                tree[0] = w;
+            }
+        }
+
+        inline bool is_text_separator(char c, char delimiter) {
+            return c == delimiter || c == '\n' || c == ' ' || c == '\t' || c == '\r';
+        }
+
+        /**
+         * @brief Parses every number in [first, last) with std::from_chars and appends it to out.
+         *
+         * Numbers are separated by delimiter or whitespace; empty fields are skipped.
+         *
+         * @param origin Start of the whole text, used to report error offsets
+         * @throws std::runtime_error If a field is not a number of type T
+         */
+        template<typename T>
+        void parse_text_chunk(const char* first, const char* last, char delimiter, const char* origin, std::vector<T>& out) {
+            // size the output from the separator density of a short sample
+            const size_t sampleBytes = std::min<size_t>(static_cast<size_t>(last - first), 4096);
+            const size_t sampleSeparators = static_cast<size_t>(std::count_if(first, first + sampleBytes,
+                [delimiter](char c) { return is_text_separator(c, delimiter); }));
+            out.reserve(out.size() + (sampleSeparators + 1) * static_cast<size_t>(last - first) / std::max<size_t>(sampleBytes, 1) + 16);
+            const char* p = first;
+            while (true) {
+                while (p != last && is_text_separator(*p, delimiter)) {
+                    ++p;
+                }
+                if (p == last) {
+                    break;
+                }
+                T value;
+                auto [end, ec] = std::from_chars(p, last, value);
+                if (ec != std::errc() || (end != last && !is_text_separator(*end, delimiter))) {
+                    throw std::runtime_error("load_text: invalid number at byte " + std::to_string(p - origin) + ".");
+                }
+                out.push_back(value);
+                p = end;
+            }
+        }
+    }
+
+    /**
+     * @brief Counters reported by MyContainer::background_sort_stats().
+     */
+    struct BackgroundSortStats {
+        size_t background_builds = 0; ///< Sorted snapshots built by the background thread
+        size_t background_hits = 0; ///< Sorted traversals that found a fresh background snapshot ready
+        size_t waited_for_background = 0; ///< Sorted traversals that waited for an in-flight background build
+        size_t synchronous_builds = 0; ///< Sorted traversals that had to sort on the calling thread
+    };
+
     /**
      * @brief A generic container class that provides various iteration patterns over stored elements.
      * 
      * This template class wraps a std::vector and provides multiple ways to iterate through
      * the elements including ascending, descending, side-cross, reverse, middle-out, and normal order.
      * All sorting operations are performed on copies of the data to preserve the original order.
+     *
+     * Copies do not depend on the number of elements: the element storage and the cached
+     * sorted snapshot are shared between copies (copy-on-write). The first mutation of a
+     * shared container duplicates its storage and drops its sorted snapshot; the other
+     * copies are unaffected.
      * 
      * @tparam T The type of elements to store (defaults to int)
      */
     template<typename T = int>
     class MyContainer {
         private:
-            std::vector<T> data; ///< Internal storage vector for container elements
+            /**
+             * @brief Background thread that rebuilds the sorted snapshot once writes go quiet.
+             *
+             * The worker never holds the container: it sees the storage through a weak_ptr, so
+             * it does not defeat copy-on-write during a write burst. Once no write has arrived
+             * for the quiet period it copies the storage while holding the mutex (writers take
+             * the same mutex, so none can run during the copy), sorts the copy outside the
+             * lock, and publishes the result tagged with the write version it was built from.
+             */
+            struct BackgroundSorter {
+                std::mutex mutex; ///< Guards every field below and serializes container writes with the worker
+                std::condition_variable wake; ///< Signals writes, finished builds and shutdown
+                std::chrono::milliseconds quiet; ///< Write-free interval required before building
+                std::chrono::steady_clock::time_point lastWrite; ///< Time of the latest write
+                std::weak_ptr<std::vector<T>> source; ///< Storage to sort (does not pin it)
+                uint64_t version = 0; ///< Incremented on every write
+                std::shared_ptr<const std::vector<T>> result; ///< Latest background snapshot
+                uint64_t resultVersion = UINT64_MAX; ///< Version result was built from
+                bool building = false; ///< True while the worker sorts outside the lock
+                uint64_t buildingVersion = 0; ///< Version being sorted while building is true
+                bool stop = false; ///< Asks the worker to exit
+                std::atomic<size_t> backgroundBuilds{0};
+                std::atomic<size_t> hits{0};
+                std::atomic<size_t> waited{0};
+                std::atomic<size_t> syncBuilds{0};
+                std::thread worker;
+
+                explicit BackgroundSorter(std::chrono::milliseconds quietPeriod)
+                    : quiet(quietPeriod), lastWrite(std::chrono::steady_clock::now()) {
+                    worker = std::thread([this]() { run(); });
+                }
+
+                ~BackgroundSorter() {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        stop = true;
+                    }
+                    wake.notify_all();
+                    worker.join();
+                }
+
+                /**
+                 * @brief Records a write (mutex held by the caller).
+                 */
+                void noteWrite(const std::shared_ptr<std::vector<T>>& storage) {
+                    ++version;
+                    lastWrite = std::chrono::steady_clock::now();
+                    source = storage;
+                    result.reset();
+                    wake.notify_all();
+                }
+
+                void run() {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    while (!stop) {
+                        if (resultVersion == version) {
+                            wake.wait(lock);
+                            continue;
+                        }
+                        auto readyAt = lastWrite + quiet;
+                        if (std::chrono::steady_clock::now() < readyAt) {
+                            wake.wait_until(lock, readyAt);
+                            continue;
+                        }
+                        const uint64_t buildVersion = version;
+                        // copied under the lock: a writer may mutate the storage in place as soon as the lock is free
+                        std::shared_ptr<const std::vector<T>> pinned = source.lock();
+                        auto fresh = pinned ? std::make_shared<std::vector<T>>(*pinned) : std::make_shared<std::vector<T>>();
+                        pinned.reset();
+                        building = true;
+                        buildingVersion = buildVersion;
+                        lock.unlock();
+
+                        std::sort(fresh->begin(), fresh->end());
+
+                        lock.lock();
+                        building = false;
+                        ++backgroundBuilds;
+                        if (buildVersion == version) {
+                            result = std::move(fresh);
+                            resultVersion = buildVersion;
+                        }
+                        wake.notify_all();
+                    }
+                }
+            };
+
+            std::shared_ptr<std::vector<T>> data; ///< Internal storage vector, shared between copies until mutated (null when empty)
+            mutable std::shared_ptr<const std::vector<T>> sortedCache; ///< Ascending sorted snapshot, null when stale
+            std::unique_ptr<BackgroundSorter> sorter; ///< Background re-sort state, null unless enabled
+
+            /**
+             * @brief Incrementally maintained top-K (see track_top_k).
+             */
+            struct TopKTracker {
+                size_t k = 0; ///< Number of values tracked, 0 when disabled
+                std::vector<T> heap; ///< Min-heap of the k largest values seen
+                bool stale = false; ///< Set when a remove() may have deleted a tracked value
+            };
+            mutable TopKTracker topTracker; ///< Rebuilt lazily by tracked_top_k() when stale
+            std::shared_ptr<std::vector<T>> sortedIndex; ///< Incrementally maintained sorted copy, null unless enabled
+            size_t sketchK = 0; ///< Accuracy parameter of the quantile sketch
+
+            /**
+             * @brief Bloom filter over the elements plus the bookkeeping that decides when to rebuild it.
+             */
+            struct BloomState {
+                BloomFilter<T> filter; ///< Summary of every value inserted since the last rebuild
+                double rate; ///< Target false-positive rate
+                size_t capacity; ///< Number of insertions the filter was sized for
+                size_t inserted; ///< Insertions since the last rebuild
+                size_t removed; ///< Elements removed since the last rebuild (their bits are still set)
+            };
+            std::shared_ptr<BloomState> bloom; ///< Shared between copies until one writes, null unless enabled
+            mutable std::shared_ptr<HyperLogLog<T>> distinctSketch; ///< Shared between copies until one writes, null unless enabled
+            mutable bool distinctStale = false; ///< Set by remove(); the registers are rebuilt on the next query
+
+            /**
+             * @brief Records value in the HyperLogLog registers, duplicating them if a copy shares them.
+             */
+            void distinctInsert(const T& value) {
+                if constexpr (Hashable<T>) {
+                    if (distinctSketch.use_count() > 1) {
+                        distinctSketch = std::make_shared<HyperLogLog<T>>(*distinctSketch);
+                    }
+                    distinctSketch->add(value);
+                }
+            }
+
+            /**
+             * @brief Rebuilds the Bloom filter from the current elements.
+             *
+             * Sized for twice the current size, so the next rebuild for growth is
+             * amortized over as many add() calls as there are elements. A no-op for types
+             * without std::hash, which can never enable the filter.
+             */
+            void rebuildBloom(double rate) {
+                if constexpr (Hashable<T>) {
+                    const size_t capacity = std::max<size_t>(1024, 2 * items().size());
+                    auto fresh = std::make_shared<BloomState>(BloomState{BloomFilter<T>(capacity, rate), rate, capacity, 0, 0});
+                    for (const T& value : items()) {
+                        fresh->filter.insert(value);
+                    }
+                    fresh->inserted = items().size();
+                    bloom = std::move(fresh);
+                } else {
+                    (void)rate;
+                }
+            }
+
+            /**
+             * @brief Returns the Bloom state ready for an update, duplicating it if a copy shares it.
+             */
+            BloomState& mutableBloom() {
+                if (bloom.use_count() > 1) {
+                    bloom = std::make_shared<BloomState>(*bloom);
+                }
+                return *bloom;
+            }
+
+            /**
+             * @brief Records one insertion in the Bloom filter, rebuilding it when it is over capacity.
+             */
+            void bloomInsert(const T& value) {
+                if constexpr (Hashable<T>) {
+                    BloomState& b = mutableBloom();
+                    if (b.inserted + 1 > b.capacity) {
+                        rebuildBloom(b.rate); // already includes value
+                        return;
+                    }
+                    b.filter.insert(value);
+                    ++b.inserted;
+                }
+            }
+            mutable std::optional<std::pair<T, T>> extremes; ///< (min, max), empty when unknown
+            mutable std::optional<KllSketch<T>> sketch; ///< Approximate quantile sketch, empty unless enabled
+            mutable bool sketchStale = false; ///< Set by remove(); the sketch is rebuilt on the next query
+            mutable detail::CacheMutex cacheMutex; ///< Serializes const methods that rebuild extremes, top-K or the sketches
+
+            /**
+             * @brief Returns the quantile sketch, rebuilding it from the elements if a remove() made it stale.
+             *
+             * Only writers mark the sketch stale, so once this returns the sketch does not
+             * change until the next write.
+             */
+            const KllSketch<T>& currentSketch() const {
+                std::lock_guard<std::mutex> lock(cacheMutex.m);
+                if (sketchStale) {
+                    KllSketch<T> fresh(sketchK);
+                    for (const T& value : items()) {
+                        fresh.update(value);
+                    }
+                    sketch = std::move(fresh);
+                    sketchStale = false;
+                }
+                return *sketch;
+            }
+
+            /**
+             * @brief Returns (min, max) of n > 0 elements in one pass.
+             *
+             * For arithmetic T the pass keeps eight independent running minima and maxima
+             * written as selects, which the compiler turns into packed SIMD min/max.
+             */
+            static std::pair<T, T> reduceMinMax(const T* p, size_t n) {
+                size_t i = 1;
+                T lo = p[0];
+                T hi = p[0];
+                if constexpr (std::is_arithmetic_v<T>) {
+                    constexpr size_t lanes = 8;
+                    if (n >= 2 * lanes) {
+                        T los[lanes];
+                        T his[lanes];
+                        for (size_t j = 0; j < lanes; ++j) {
+                            los[j] = his[j] = p[j];
+                        }
+                        for (i = lanes; i + lanes <= n; i += lanes) {
+                            for (size_t j = 0; j < lanes; ++j) {
+                                los[j] = p[i + j] < los[j] ? p[i + j] : los[j];
+                                his[j] = his[j] < p[i + j] ? p[i + j] : his[j];
+                            }
+                        }
+                        for (size_t j = 0; j < lanes; ++j) {
+                            lo = los[j] < lo ? los[j] : lo;
+                            hi = hi < his[j] ? his[j] : hi;
+                        }
+                    }
+                }
+                for (; i < n; ++i) {
+                    if (p[i] < lo) {
+                        lo = p[i];
+                    }
+                    if (hi < p[i]) {
+                        hi = p[i];
+                    }
+                }
+                return {lo, hi};
+            }
+
+            /**
+             * @brief Returns (min, max) of a non-empty container, recomputing them if unknown.
+             */
+            std::pair<T, T> minMax(size_t threads = 1) const {
+                std::lock_guard<std::mutex> lock(cacheMutex.m);
+                if (!extremes) {
+                    if (auto sorted = readySorted()) {
+                        extremes.emplace(sorted->front(), sorted->back());
+                    } else if (threads == 1) {
+                        extremes = reduceMinMax(items().data(), items().size());
+                    } else {
+                        auto partials = blockReduce(threads, reduceMinMax);
+                        std::pair<T, T> result = partials[0];
+                        for (const auto& part : partials) {
+                            if (part.first < result.first) {
+                                result.first = part.first;
+                            }
+                            if (result.second < part.second) {
+                                result.second = part.second;
+                            }
+                        }
+                        extremes = std::move(result);
+                    }
+                }
+                return *extremes;
+            }
+
+        public:
+            static constexpr size_t reduce_block = 4096; ///< Elements per partial result in sum()/variance()
+            static constexpr size_t gallop_ratio = 8; ///< Size ratio from which set_intersection() gallops (int only)
+
+            /**
+             * @brief Accumulator type of sum(): double (long double) for floating T, 64-bit integer otherwise.
+             */
+            using sum_type = typename detail::sum_type_of<T>::type;
+
+        private:
+            /**
+             * @brief Applies fn(const T*, size_t) to every reduce_block-sized block, on up to threads threads.
+             *
+             * Block boundaries depend only on size(), and the caller folds the returned partials
+             * in block order, so the result is bit-identical for every thread count.
+             *
+             * @param threads Number of threads (0 = hardware concurrency)
+             * @return std::vector of one partial per block, in block order (non-empty container only)
+             */
+            template<typename BlockFn>
+            std::vector<std::invoke_result_t<BlockFn, const T*, size_t>> blockReduce(size_t threads, BlockFn fn) const {
+                const T* p = items().data();
+                const size_t n = items().size();
+                const size_t blocks = (n + reduce_block - 1) / reduce_block;
+                std::vector<std::invoke_result_t<BlockFn, const T*, size_t>> partials(blocks);
+                if (threads == 0) {
+                    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+                }
+                threads = std::min(threads, std::max<size_t>(1, blocks));
+                auto work = [&](size_t t) {
+                    for (size_t b = t; b < blocks; b += threads) {
+                        const size_t first = b * reduce_block;
+                        partials[b] = fn(p + first, std::min(reduce_block, n - first));
+                    }
+                };
+                std::vector<std::thread> workers;
+                for (size_t t = 1; t < threads; ++t) {
+                    workers.emplace_back(work, t);
+                }
+                work(0);
+                for (auto& w : workers) {
+                    w.join();
+                }
+                return partials;
+            }
+
+            /**
+             * @brief Sums one block with eight independent accumulators the compiler vectorizes.
+             */
+            static sum_type sumBlock(const T* p, size_t n) {
+                constexpr size_t lanes = 8;
+                sum_type acc[lanes] = {};
+                size_t i = 0;
+                for (; i + lanes <= n; i += lanes) {
+                    for (size_t j = 0; j < lanes; ++j) {
+                        acc[j] += static_cast<sum_type>(p[i + j]);
+                    }
+                }
+                sum_type total = 0;
+                for (size_t j = 0; j < lanes; ++j) {
+                    total += acc[j];
+                }
+                for (; i < n; ++i) {
+                    total += static_cast<sum_type>(p[i]);
+                }
+                return total;
+            }
+
+            /**
+             * @brief Sums (x - mean)^2 over one block, eight lanes at a time.
+             */
+            static double squaredDeviationBlock(const T* p, size_t n, double mean) {
+                constexpr size_t lanes = 8;
+                double acc[lanes] = {};
+                size_t i = 0;
+                for (; i + lanes <= n; i += lanes) {
+                    for (size_t j = 0; j < lanes; ++j) {
+                        const double d = static_cast<double>(p[i + j]) - mean;
+                        acc[j] += d * d;
+                    }
+                }
+                double total = 0;
+                for (size_t j = 0; j < lanes; ++j) {
+                    total += acc[j];
+                }
+                for (; i < n; ++i) {
+                    const double d = static_cast<double>(p[i]) - mean;
+                    total += d * d;
+                }
+                return total;
+            }
+
+            /**
+             * @brief Returns the sorted index ready for an in-place update.
+             *
+             * The index doubles as the published snapshot, so it is duplicated first if an
+             * iterator, range or container copy still holds it.
+             */
+            std::vector<T>& mutableIndex() {
+                if (sortedIndex.use_count() > 1) {
+                    sortedIndex = std::make_shared<std::vector<T>>(*sortedIndex);
+                }
+                return *sortedIndex;
+            }
+
+            /**
+             * @brief Republishes the sorted index as the cached snapshot after a write.
+             */
+            void publishIndex() {
+                std::atomic_store(&sortedCache, std::shared_ptr<const std::vector<T>>(sortedIndex));
+            }
+
+            /**
+             * @brief Selects the k elements that rank best under better, best first.
+             *
+             * Keeps a bounded heap whose top is the worst element kept so far. For arithmetic T
+             * the scan first tests blocks of 16 elements against that threshold with a
+             * branch-free loop the compiler vectorizes, and only touches the heap for blocks
+             * that contain a candidate, so most of the input is rejected at SIMD speed.
+             */
+            template<typename Better>
+            static std::vector<T> selectK(const std::vector<T>& source, size_t k, Better better) {
+                std::vector<T> heap;
+                k = std::min(k, source.size());
+                if (k == 0) {
+                    return heap;
+                }
+                heap.reserve(k);
+                const T* p = source.data();
+                const size_t n = source.size();
+                size_t i = 0;
+                for (; i < n && heap.size() < k; ++i) {
+                    heap.push_back(p[i]);
+                    std::push_heap(heap.begin(), heap.end(), better);
+                }
+                auto offer = [&heap, &better](const T& value) {
+                    if (better(value, heap.front())) {
+                        std::pop_heap(heap.begin(), heap.end(), better);
+                        heap.back() = value;
+                        std::push_heap(heap.begin(), heap.end(), better);
+                    }
+                };
+                if constexpr (std::is_arithmetic_v<T>) {
+                    constexpr size_t block = 16;
+                    for (; i + block <= n; i += block) {
+                        const T threshold = heap.front();
+                        bool candidate = false;
+                        for (size_t j = 0; j < block; ++j) {
+                            candidate |= better(p[i + j], threshold);
+                        }
+                        if (candidate) {
+                            for (size_t j = 0; j < block; ++j) {
+                                offer(p[i + j]);
+                            }
+                        }
+                    }
+                }
+                for (; i < n; ++i) {
+                    offer(p[i]);
+                }
+                std::sort_heap(heap.begin(), heap.end(), better);
+                return heap;
+            }
+
+            /**
+             * @brief Comparators as empty function objects, so selectK and the heap algorithms
+             *        inline them (a function pointer would be an indirect call per element).
+             */
+            struct GreaterThan {
+                bool operator()(const T& a, const T& b) const {
+                    return b < a;
+                }
+            };
+
+            struct LessThan {
+                bool operator()(const T& a, const T& b) const {
+                    return a < b;
+                }
+            };
+
+            static constexpr GreaterThan greaterThan{};
+            static constexpr LessThan lessThan{};
+
+            /**
+             * @brief Keeps derived state current after value was appended.
+             */
+            void onAdded(const T& value) {
+                if (sortedIndex) {
+                    std::vector<T>& index = mutableIndex();
+                    index.insert(std::upper_bound(index.begin(), index.end(), value), value);
+                    publishIndex();
+                }
+                if (items().size() == 1) {
+                    extremes.emplace(value, value);
+                } else if (extremes) {
+                    if (value < extremes->first) {
+                        extremes->first = value;
+                    } else if (extremes->second < value) {
+                        extremes->second = value;
+                    }
+                }
+                if (sketch && !sketchStale) {
+                    sketch->update(value);
+                }
+                if (bloom) {
+                    bloomInsert(value);
+                }
+                if (distinctSketch && !distinctStale) {
+                    distinctInsert(value);
+                }
+                offerTopK(value);
+            }
+
+            /**
+             * @brief Keeps derived state current after a batch was appended.
+             */
+            void onAddedAll(std::span<const T> values) {
+                if (sortedIndex && !values.empty()) {
+                    // one sort of the batch plus a linear merge instead of a binary insert per element
+                    std::vector<T>& index = mutableIndex();
+                    const size_t mid = index.size();
+                    index.insert(index.end(), values.begin(), values.end());
+                    std::sort(index.begin() + mid, index.end());
+                    std::inplace_merge(index.begin(), index.begin() + mid, index.end());
+                    publishIndex();
+                }
+                if (!values.empty() && (extremes || items().size() == values.size())) {
+                    std::pair<T, T> batch = reduceMinMax(values.data(), values.size());
+                    if (items().size() == values.size()) {
+                        extremes = std::move(batch);
+                    } else {
+                        if (batch.first < extremes->first) {
+                            extremes->first = std::move(batch.first);
+                        }
+                        if (extremes->second < batch.second) {
+                            extremes->second = std::move(batch.second);
+                        }
+                    }
+                }
+                if (sketch && !sketchStale) {
+                    for (const T& value : values) {
+                        sketch->update(value);
+                    }
+                }
+                if (bloom) {
+                    if (bloom->inserted + values.size() > bloom->capacity) {
+                        rebuildBloom(bloom->rate);
+                    } else {
+                        for (const T& value : values) {
+                            bloomInsert(value);
+                        }
+                    }
+                }
+                if (distinctSketch && !distinctStale) {
+                    for (const T& value : values) {
+                        distinctInsert(value);
+                    }
+                }
+                for (const T& value : values) {
+                    offerTopK(value);
+                }
+            }
+
+            /**
+             * @brief Offers a newly added value to the top-K tracker.
+             */
+            void offerTopK(const T& value) {
+                TopKTracker& t = topTracker;
+                if (t.k == 0 || t.stale) {
+                    return;
+                }
+                if (t.heap.size() < t.k) {
+                    t.heap.push_back(value);
+                    std::push_heap(t.heap.begin(), t.heap.end(), greaterThan);
+                } else if (t.heap.front() < value) {
+                    std::pop_heap(t.heap.begin(), t.heap.end(), greaterThan);
+                    t.heap.back() = value;
+                    std::push_heap(t.heap.begin(), t.heap.end(), greaterThan);
+                }
+            }
+
+            /**
+             * @brief Keeps derived state current after every copy of value was removed.
+             *
+             * @param value The removed value
+             * @param removedCount How many elements were removed
+             */
+            void onRemoved(const T& value, size_t removedCount) {
+                if (sortedIndex) {
+                    std::vector<T>& index = mutableIndex();
+                    auto [lo, hi] = std::equal_range(index.begin(), index.end(), value);
+                    index.erase(lo, hi);
+                    publishIndex();
+                }
+                if (extremes && (!(extremes->first < value) || !(value < extremes->second))) {
+                    extremes.reset(); // an extreme was deleted; min()/max() recompute on demand
+                }
+                if (sketch) {
+                    sketchStale = true; // a KLL sketch cannot forget items
+                }
+                if (bloom) {
+                    // removed values keep their bits; rebuild once they are half the filter's entries
+                    BloomState& b = mutableBloom();
+                    b.removed += removedCount;
+                    if (2 * b.removed > b.inserted) {
+                        rebuildBloom(b.rate);
+                    }
+                }
+                if (distinctSketch) {
+                    distinctStale = true; // registers cannot forget a value
+                }
+                TopKTracker& t = topTracker;
+                if (t.k != 0 && !t.stale && !(value < t.heap.front())) {
+                    t.stale = true; // value may have been one of the tracked ones
+                }
+            }
+
+            /**
+             * @brief Resets derived state after the storage was emptied, keeping the enabled options.
+             */
+            void onCleared() {
+                extremes.reset();
+                if (bloom) {
+                    rebuildBloom(bloom->rate);
+                }
+                if (distinctSketch) {
+                    distinctStale = true;
+                }
+                if (sketch) {
+                    sketchStale = true;
+                }
+                if (sortedIndex) {
+                    sortedIndex = std::make_shared<std::vector<T>>();
+                    publishIndex();
+                }
+                if (topTracker.k != 0) {
+                    topTracker.stale = true;
+                }
+            }
+
+            /**
+             * @brief Copies other's options and derived state: shared pointers, plus the O(k) top-K heap and sketch.
+             */
+            void copyDerivedFrom(const MyContainer& other) {
+                std::lock_guard<std::mutex> lock(other.cacheMutex.m);
+                topTracker = other.topTracker;
+                sortedIndex = other.sortedIndex;
+                sketchK = other.sketchK;
+                bloom = other.bloom;
+                distinctSketch = other.distinctSketch;
+                distinctStale = other.distinctStale;
+                extremes = other.extremes;
+                sketch = other.sketch;
+                sketchStale = other.sketchStale;
+            }
+
+            /**
+             * @brief Empties the container through the write path and returns its storage, keeping its enabled options.
+             *
+             * The storage is detached under this container's own write lock, so its background
+             * sorter (if any) has finished copying it and never sees it again.
+             */
+            std::shared_ptr<std::vector<T>> takeItems() {
+                std::shared_ptr<std::vector<T>> taken;
+                write([this, &taken]() {
+                    taken = std::move(data);
+                    std::atomic_store(&sortedCache, std::shared_ptr<const std::vector<T>>());
+                });
+                onCleared();
+                return taken;
+            }
+
+            /**
+             * @brief Builds a container from ascending elements, which double as its sorted snapshot.
+             */
+            static MyContainer fromSorted(std::vector<T>&& sorted) {
+                MyContainer result;
+                if (!sorted.empty()) {
+                    result.data = std::make_shared<std::vector<T>>(std::move(sorted));
+                    result.sortedCache = result.data; // aliases the storage; mutableItems() drops it before checking ownership
+                }
+                return result;
+            }
+
+            /**
+             * @brief Runs op(a, b, out) over the two sorted snapshots and wraps the output.
+             */
+            template<typename Op>
+            MyContainer combineSorted(const MyContainer& other, Op op) const {
+                auto a = sortedSnapshot();
+                auto b = other.sortedSnapshot();
+                std::vector<T> out;
+                out.reserve(std::max(a->size(), b->size()));
+                op(*a, *b, std::back_inserter(out));
+                return fromSorted(std::move(out));
+            }
+
+            /**
+             * @brief Formats the elements in the given order as "[ a, b, c ]" through a ChunkedWriter.
+             */
+            template<typename Sink>
+            void writeFormatted(Order order, Sink& sink, int precision) const {
+                detail::ChunkedWriter<Sink> out(sink, precision);
+                out.append("[ ", 2);
+                bool first = true;
+                auto emit = [&out, &first](const T& value) {
+                    if (!first) {
+                        out.append(", ", 2);
+                    }
+                    first = false;
+                    out.append_value(value);
+                };
+                switch (order) {
+                    case Order::Ascending:  visit<Order::Ascending>(emit); break;
+                    case Order::Descending: visit<Order::Descending>(emit); break;
+                    case Order::SideCross:  visit<Order::SideCross>(emit); break;
+                    case Order::Reverse:    visit<Order::Reverse>(emit); break;
+                    case Order::Normal:     visit<Order::Normal>(emit); break;
+                    case Order::MiddleOut:  visit<Order::MiddleOut>(emit); break;
+                    default: throw std::invalid_argument("write_to: unknown order");
+                }
+                out.append(" ]", 2);
+                out.flush();
+            }
+
+            /**
+             * @brief True if the Bloom filter proves value is absent.
+             */
+            bool rejectedByBloom(const T& value) const {
+                if constexpr (Hashable<T>) {
+                    return bloom && !bloom->filter.might_contain(value);
+                } else {
+                    return false;
+                }
+            }
+
+            /**
+             * @brief Read access to the element storage.
+             */
+            const std::vector<T>& items() const {
+                static const std::vector<T> none;
+                return data ? *data : none;
+            }
+
+            /**
+             * @brief Write access to the element storage.
+             *
+             * Duplicates the storage first if another copy still shares it, and drops
+             * the sorted snapshot, which the caller is about to make stale.
+             */
+            std::vector<T>& mutableItems() {
+                // drop the snapshot first: when it aliases the storage (see fromSorted) that
+                // reference alone must not force a copy
+                std::atomic_store(&sortedCache, std::shared_ptr<const std::vector<T>>());
+                if (!data) {
+                    data = std::make_shared<std::vector<T>>();
+                } else if (data.use_count() > 1) {
+                    data = std::make_shared<std::vector<T>>(*data);
+                }
+                return *data;
+            }
+
+            /**
+             * @brief Returns the ascending sorted snapshot, building and caching it if stale.
+             *
+             * Safe to call concurrently from several readers; the snapshot is immutable and
+             * shared with copies of the container until one of them is mutated.
+             */
+            std::shared_ptr<const std::vector<T>> sortedSnapshot() const {
+                std::shared_ptr<const std::vector<T>> snapshot = std::atomic_load(&sortedCache);
+                if (snapshot) {
+                    return snapshot;
+                }
+                if (sorter) {
+                    std::unique_lock<std::mutex> lock(sorter->mutex);
+                    if (sorter->building && sorter->buildingVersion == sorter->version) {
+                        sorter->wake.wait(lock, [this]() { return !sorter->building; });
+                        if (sorter->resultVersion == sorter->version) {
+                            ++sorter->waited;
+                        }
+                    } else if (sorter->resultVersion == sorter->version) {
+                        ++sorter->hits;
+                    }
+                    if (sorter->resultVersion == sorter->version) {
+                        snapshot = sorter->result;
+                    } else {
+                        ++sorter->syncBuilds;
+                    }
+                }
+                if (!snapshot) {
+                    auto fresh = std::make_shared<std::vector<T>>(items());
+                    std::sort(fresh->begin(), fresh->end());
+                    snapshot = std::move(fresh);
+                }
+                std::atomic_store(&sortedCache, snapshot);
+                return snapshot;
+            }
+
+            /**
+             * @brief Runs a write, serialized with the background sorter when it is enabled.
+             *
+             * Every mutation of the storage goes through here so the sorter sees each write.
+             */
+            template<typename Fn>
+            void write(Fn&& fn) {
+                if (!sorter) {
+                    fn();
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(sorter->mutex);
+                fn();
+                sorter->noteWrite(data);
+            }
+
+            /**
+             * @brief Returns the sorted snapshot only if it is available without sorting.
+             *
+             * That is the cached snapshot, or a finished background snapshot of the current
+             * data (which is then adopted as the cache). Returns null otherwise.
+             */
+            std::shared_ptr<const std::vector<T>> readySorted() const {
+                std::shared_ptr<const std::vector<T>> snapshot = std::atomic_load(&sortedCache);
+                if (!snapshot && sorter) {
+                    std::lock_guard<std::mutex> lock(sorter->mutex);
+                    if (sorter->resultVersion == sorter->version) {
+                        snapshot = sorter->result;
+                        ++sorter->hits;
+                        std::atomic_store(&sortedCache, snapshot);
+                    }
+                }
+                return snapshot;
+            }
+
+            /**
+             * @brief Places the elements at the given sorted positions, sharing partitioning work.
+             *
+             * Selects the middle requested position with nth_element, then recurses into the
+             * two sides with the requested positions that fall there, so k positions cost one
+             * O(n log k) multi-selection instead of k separate O(n) selections.
+             *
+             * @param first,last The range being partitioned
+             * @param kb,ke Sorted, unique requested positions that lie within [first, last)
+             * @param offset Sorted position of *first
+             */
+            template<typename It>
+            static void multiSelect(It first, It last, const size_t* kb, const size_t* ke, size_t offset) {
+                if (kb == ke || first == last) {
+                    return;
+                }
+                const size_t* mid = kb + (ke - kb) / 2;
+                It nth = first + (*mid - offset);
+                std::nth_element(first, nth, last);
+                multiSelect(first, nth, kb, mid, offset);
+                multiSelect(nth + 1, last, mid + 1, ke, *mid + 1);
+            }
+
+        public:
+    
+            /**
+             * @brief Default constructor.
+             * 
+             * Creates an empty container with no elements.
+             */
+            MyContainer() = default;
+
+            /**
+             * @brief Copy constructor (copy-on-write; independent of the number of elements).
+             *
+             * Shares the element storage, the sorted snapshot, the sorted index, the Bloom
+             * filter and the HyperLogLog registers with other, and copies the tracked top-K
+             * heap and the quantile sketch (O(k) each). The copy has the same options as
+             * other, except background sorting, which is not inherited.
+             */
+            MyContainer(const MyContainer& other)
+                : data(other.data), sortedCache(std::atomic_load(&other.sortedCache)) {
+                copyDerivedFrom(other);
+            }
+
+            /**
+             * @brief Copy assignment, with the same sharing and cost as the copy constructor.
+             *
+             * This container takes other's elements and options; whether it sorts in the
+             * background stays as it was.
+             */
+            MyContainer& operator=(const MyContainer& other) {
+                if (this != &other) {
+                    auto otherSorted = std::atomic_load(&other.sortedCache);
+                    write([this, &other]() { data = other.data; });
+                    std::atomic_store(&sortedCache, std::move(otherSorted));
+                    copyDerivedFrom(other);
+                }
+                return *this;
+            }
+
+            MyContainer(MyContainer&&) noexcept = default;
+            MyContainer& operator=(MyContainer&&) noexcept = default;
+
+            /**
+             * @brief Default destructor.
+             * 
+             * Automatically cleans up all stored elements.
+             */
+            ~MyContainer() = default;
+            
+            /**
+             * @brief Adds an element to the container.
+             * 
+             * @param value The value to add to the container (passed by const reference)
+             */
+            void add(const T& value) {
+                write([&]() { mutableItems().push_back(value); });
+                onAdded(value);
+            }
+
+            /**
+             * @brief Appends a batch of elements in one step.
+             *
+             * Reserves once and copies the whole batch, which is cheaper than calling
+             * add() per element.
+             *
+             * @param values The values to append, in order
+             */
+            void add_all(std::span<const T> values) {
+                write([&]() {
+                    std::vector<T>& storage = mutableItems();
+                    storage.insert(storage.end(), values.begin(), values.end());
+                });
+                onAddedAll(values);
+            }
+
+            /**
+             * @brief Moves other's elements to the end of this container.
+             *
+             * If either container has its sorted snapshot ready, the combined snapshot is
+             * produced by one linear merge (sorting only the side that had none) instead of
+             * a full re-sort on the next sorted traversal. other is left empty.
+             *
+             * @param other The container to absorb
+             */
+            void merge(MyContainer&& other) {
+                merge_all(std::span<MyContainer>(&other, 1));
+            }
+
+            /**
+             * @brief Moves the elements of every container in others to the end of this one, in order.
+             *
+             * If any input has its sorted snapshot ready, the combined snapshot is built
+             * by a loser-tree k-way merge of all the snapshots. With the sorted index
+             * enabled, the index absorbs the batch instead. Elements are moved out of inputs
+             * that own their storage (and the buffer itself is adopted when this container is
+             * empty); inputs sharing their storage with copies are appended from without
+             * copying it first. The inputs are left empty but keep their enabled options.
+             *
+             * @param others Distinct containers to absorb (this container itself is skipped)
+             */
+            void merge_all(std::span<MyContainer> others) {
+                std::vector<std::shared_ptr<const std::vector<T>>> snapshots{readySorted()};
+                bool anyReady = !sortedIndex && snapshots[0] != nullptr;
+                std::vector<MyContainer*> sources;
+                size_t added = 0;
+                for (MyContainer& other : others) {
+                    if (&other != this && other.size() > 0) {
+                        sources.push_back(&other);
+                        snapshots.push_back(other.readySorted());
+                        anyReady = anyReady || (!sortedIndex && snapshots.back() != nullptr);
+                        added += other.size();
+                    }
+                }
+                if (added == 0) {
+                    return;
+                }
+                std::shared_ptr<std::vector<T>> combined;
+                if (anyReady) {
+                    std::vector<std::span<const T>> runs;
+                    std::vector<std::vector<T>> sortedCopies;
+                    sortedCopies.reserve(snapshots.size());
+                    size_t i = 0;
+                    auto addRun = [&](const MyContainer& source) {
+                        if (!snapshots[i]) {
+                            sortedCopies.emplace_back(source.items());
+                            std::sort(sortedCopies.back().begin(), sortedCopies.back().end());
+                            runs.emplace_back(sortedCopies.back());
+                        } else {
+                            runs.emplace_back(*snapshots[i]);
+                        }
+                        ++i;
+                    };
+                    addRun(*this);
+                    for (MyContainer* other : sources) {
+                        addRun(*other);
+                    }
+                    combined = std::make_shared<std::vector<T>>();
+                    combined->reserve(size() + added);
+                    detail::merge_runs(runs, *combined);
+                }
+                // each input gives up its storage under its own write lock first, so no input's
+                // background sorter can still be reading a buffer this container then mutates
+                snapshots.clear(); // a snapshot aliasing an input's storage would otherwise force a copy below
+                std::vector<std::shared_ptr<std::vector<T>>> taken;
+                taken.reserve(sources.size());
+                for (MyContainer* other : sources) {
+                    taken.push_back(other->takeItems());
+                }
+                const size_t oldSize = size();
+                write([&]() {
+                    for (std::shared_ptr<std::vector<T>>& buffer : taken) {
+                        // a uniquely owned buffer is adopted whole (when this is empty) or moved
+                        // from; a buffer shared with copies is appended from without detaching it
+                        const bool owned = buffer.use_count() == 1;
+                        if (owned && size() == 0) {
+                            data = std::move(buffer);
+                            std::atomic_store(&sortedCache, std::shared_ptr<const std::vector<T>>());
+                            data->reserve(oldSize + added);
+                            continue;
+                        }
+                        std::vector<T>& storage = mutableItems();
+                        storage.reserve(oldSize + added);
+                        if (owned) {
+                            storage.insert(storage.end(), std::make_move_iterator(buffer->begin()),
+                                           std::make_move_iterator(buffer->end()));
+                        } else {
+                            storage.insert(storage.end(), buffer->begin(), buffer->end());
+                        }
+                    }
+                });
+                onAddedAll(std::span<const T>(items().data() + oldSize, size() - oldSize));
+                if (combined) {
+                    std::atomic_store(&sortedCache, std::shared_ptr<const std::vector<T>>(std::move(combined)));
+                }
+            }
+
+            /**
+             * @brief Removes all occurrences of a specific value from the container.
+             * 
+             * This method removes every instance of the specified value found in the container.
+             * If the value is not found, it throws a runtime_error exception.
+             * 
+             * @param value The value to remove from the container (passed by const reference)
+             * @throws std::runtime_error If the element is not found in the container
+             */
+            void remove(const T& value) {
+                const size_t at = find(value);
+                if (at == npos) {
+                    throw std::runtime_error("Element not found in container."); // nothing to detach or invalidate
+                }
+                const size_t before = size();
+                write([&]() {
+                    // everything before the first match is kept as is, so compaction starts there
+                    std::vector<T>& storage = mutableItems();
+                    if constexpr (simd::has_kernels<T>) {
+                        storage.resize(at + simd::remove_equal(storage.data() + at, storage.size() - at, value));
+                    } else {
+                        storage.erase(std::remove(storage.begin() + static_cast<std::ptrdiff_t>(at), storage.end(), value),
+                                      storage.end());
+                    }
+                });
+                onRemoved(value, before - size());
+            }
+
+            static constexpr size_t npos = SIZE_MAX; ///< Returned by find() when nothing matches
+
+            /**
+             * @brief Maintains a Bloom filter that lets find(), contains(), count() and remove()
+             *        reject absent values without scanning.
+             *
+             * add() keeps the filter current. Removed values cannot be cleared from it, so
+             * it is rebuilt once removals reach half of its insertions, and when growth
+             * exceeds the size it was built for.
+             *
+             * @param falsePositiveRate Fraction of absent values that still need a scan
+             */
+            void enable_bloom_filter(double falsePositiveRate = 0.01) {
+                static_assert(Hashable<T>, "enable_bloom_filter needs std::hash<T>");
+                rebuildBloom(falsePositiveRate);
+            }
+
+            /**
+             * @brief Drops the Bloom filter.
+             */
+            void disable_bloom_filter() {
+                bloom.reset();
+            }
+
+            /**
+             * @brief Returns true if a Bloom filter is maintained.
+             */
+            bool bloom_filter_enabled() const {
+                return bloom != nullptr;
+            }
+
+            /**
+             * @brief Maintains HyperLogLog registers for approx_distinct().
+             *
+             * add() updates them in O(1). They cannot forget values, so a remove() marks
+             * them stale and the next approx_distinct() rebuilds them.
+             *
+             * @param precision log2 of the register count (12 gives about 1.6% error in 4 KB)
+             */
+            void enable_distinct_sketch(unsigned precision = 12) {
+                static_assert(Hashable<T>, "enable_distinct_sketch needs std::hash<T>");
+                auto fresh = std::make_shared<HyperLogLog<T>>(precision);
+                for (const T& value : items()) {
+                    fresh->add(value);
+                }
+                distinctSketch = std::move(fresh);
+                distinctStale = false;
+            }
+
+            /**
+             * @brief Drops the HyperLogLog registers.
+             */
+            void disable_distinct_sketch() {
+                distinctSketch.reset();
+                distinctStale = false;
+            }
+
+            /**
+             * @brief Returns the estimated number of distinct elements.
+             *
+             * O(registers) from the maintained sketch; without enable_distinct_sketch() it
+             * hashes every element into temporary registers in one O(n) pass, still
+             * without sorting.
+             *
+             * @return size_t Estimate within a few percent of exact_distinct()
+             */
+            size_t approx_distinct() const {
+                static_assert(Hashable<T>, "approx_distinct needs std::hash<T>");
+                std::lock_guard<std::mutex> lock(cacheMutex.m);
+                if (distinctSketch && !distinctStale) {
+                    return static_cast<size_t>(std::llround(distinctSketch->estimate()));
+                }
+                auto fresh = std::make_shared<HyperLogLog<T>>(distinctSketch ? distinctSketch->precision_bits() : 12);
+                for (const T& value : items()) {
+                    fresh->add(value);
+                }
+                if (distinctSketch) {
+                    distinctSketch = fresh;
+                    distinctStale = false;
+                }
+                return static_cast<size_t>(std::llround(fresh->estimate()));
+            }
+
+            /**
+             * @brief Returns the multiset union of the two containers (max of the counts).
+             *
+             * One linear merge of the two sorted snapshots. The result holds its elements in
+             * ascending order and starts with that order cached as its sorted snapshot.
+             */
+            MyContainer set_union(const MyContainer& other) const {
+                return combineSorted(other, [](const auto& a, const auto& b, auto out) {
+                    std::set_union(a.begin(), a.end(), b.begin(), b.end(), out);
+                });
+            }
+
+            /**
+             * @brief Returns the multiset intersection (min of the counts), see set_union().
+             *
+             * For int, when one side is much larger it is galloped through with a SIMD
+             * block search instead of merged linearly.
+             */
+            MyContainer set_intersection(const MyContainer& other) const {
+                if constexpr (std::is_same_v<T, int>) {
+                    auto a = sortedSnapshot();
+                    auto b = other.sortedSnapshot();
+                    if (a->size() > b->size()) {
+                        std::swap(a, b);
+                    }
+                    if (a->size() * gallop_ratio <= b->size()) {
+                        std::vector<int> out(a->size());
+                        out.resize(simd::gallop_intersect(a->data(), a->size(), b->data(), b->size(), out.data()));
+                        return fromSorted(std::move(out));
+                    }
+                }
+                return combineSorted(other, [](const auto& a, const auto& b, auto out) {
+                    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out);
+                });
+            }
+
+            /**
+             * @brief Returns the elements of this container not matched in other, see set_union().
+             */
+            MyContainer set_difference(const MyContainer& other) const {
+                return combineSorted(other, [](const auto& a, const auto& b, auto out) {
+                    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+                });
+            }
+
+            /**
+             * @brief Returns the elements found in only one of the containers, see set_union().
+             */
+            MyContainer set_symmetric_difference(const MyContainer& other) const {
+                return combineSorted(other, [](const auto& a, const auto& b, auto out) {
+                    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+                });
+            }
+
+            /**
+             * @brief Returns the exact number of distinct elements.
+             *
+             * Counts value changes along the sorted snapshot: O(n) when the snapshot is
+             * cached (or maintained by the sorted index), otherwise it is built first.
+             */
+            size_t exact_distinct() const {
+                std::shared_ptr<const std::vector<T>> sorted = sortedSnapshot();
+                if (sorted->empty()) {
+                    return 0;
+                }
+                size_t distinct = 1;
+                for (size_t i = 1; i < sorted->size(); ++i) {
+                    distinct += (*sorted)[i - 1] < (*sorted)[i];
+                }
+                return distinct;
+            }
+
+            /**
+             * @brief Returns the insertion-order position of the first element equal to value.
+             *
+             * For int, float and double the scan uses SIMD compare-and-movemask kernels
+             * (AVX2 or SSE2, picked at runtime for the running CPU).
+             *
+             * @param value The value to look for
+             * @return size_t Position of the first match, or npos
+             */
+            size_t find(const T& value) const {
+                if (rejectedByBloom(value)) {
+                    return npos;
+                }
+                const std::vector<T>& current = items();
+                size_t pos;
+                if constexpr (simd::has_kernels<T>) {
+                    pos = simd::scan_kernels<T>().find(current.data(), current.size(), value);
+                } else {
+                    pos = static_cast<size_t>(std::find(current.begin(), current.end(), value) - current.begin());
+                }
+                return pos == current.size() ? npos : pos;
+            }
+
+            /**
+             * @brief Returns true if some element equals value (same scan as find()).
+             */
+            bool contains(const T& value) const {
+                return find(value) != npos;
+            }
+
+            /**
+             * @brief Returns the number of elements equal to value (SIMD for int, float and double).
+             */
+            size_t count(const T& value) const {
+                if (rejectedByBloom(value)) {
+                    return 0;
+                }
+                const std::vector<T>& current = items();
+                if constexpr (simd::has_kernels<T>) {
+                    return simd::scan_kernels<T>().count(current.data(), current.size(), value);
+                } else {
+                    return static_cast<size_t>(std::count(current.begin(), current.end(), value));
+                }
+            }
+
+            /**
+             * @brief Returns the number of elements in the container.
+             * 
+             * @return size_t The current size of the container
+             */
+            size_t size() const {
+                return items().size();
+            }
+
+            /**
+             * @brief Opts in to rebuilding the sorted snapshot on a background thread.
+             *
+             * Once no write has arrived for the quiet period, a worker thread sorts the data.
+             * Sorted traversals then pick up the fresh snapshot without sorting; if a build
+             * for the current data is in flight they wait for it, and only otherwise sort
+             * synchronously. Writes take a short lock shared with the worker while enabled.
+             *
+             * @param quiet Write-free interval before the background build starts
+             */
+            void enable_background_sort(std::chrono::milliseconds quiet = std::chrono::milliseconds(5)) {
+                sorter.reset();
+                sorter = std::make_unique<BackgroundSorter>(quiet);
+                std::lock_guard<std::mutex> lock(sorter->mutex);
+                auto cached = std::atomic_load(&sortedCache);
+                if (cached) { // nothing to build until the next write
+                    sorter->result = std::move(cached);
+                    sorter->resultVersion = sorter->version;
+                } else {
+                    sorter->noteWrite(data);
+                }
+            }
+
+            /**
+             * @brief Stops the background thread; sorted snapshots are built on demand again.
+             */
+            void disable_background_sort() {
+                sorter.reset();
+            }
+
+            /**
+             * @brief Keeps the sorted snapshot current on every write instead of re-sorting.
+             *
+             * add() then inserts into the snapshot by binary search, add_all() merges a
+             * sorted batch, and remove() erases the matching run, so sorted traversals,
+             * ascending_range() and the order statistics never need a full rebuild. Each
+             * write costs O(n) element moves (O(log n) comparisons) instead.
+             */
+            void enable_sorted_index() {
+                if (!sortedIndex) {
+                    sortedIndex = std::make_shared<std::vector<T>>(*sortedSnapshot());
+                    publishIndex();
+                }
+            }
+
+            /**
+             * @brief Stops maintaining the sorted snapshot on writes.
+             */
+            void disable_sorted_index() {
+                sortedIndex.reset();
+            }
+
+            /**
+             * @brief Returns true if the sorted snapshot is available without sorting.
+             */
+            bool sorted_snapshot_ready() const {
+                return readySorted() != nullptr;
+            }
+
+            /**
+             * @brief Returns true if the sorted index is maintained incrementally.
+             */
+            bool sorted_index_enabled() const {
+                return sortedIndex != nullptr;
+            }
+
+            /**
+             * @brief Returns true if background sorting is enabled.
+             */
+            bool background_sort_enabled() const {
+                return sorter != nullptr;
+            }
+
+            /**
+             * @brief Returns how often sorted traversals found the background snapshot ready.
+             *
+             * @return BackgroundSortStats Counters since enable_background_sort() (all zero when disabled)
+             */
+            BackgroundSortStats background_sort_stats() const {
+                BackgroundSortStats stats;
+                if (sorter) {
+                    stats.background_builds = sorter->backgroundBuilds.load();
+                    stats.background_hits = sorter->hits.load();
+                    stats.waited_for_background = sorter->waited.load();
+                    stats.synchronous_builds = sorter->syncBuilds.load();
+                }
+                return stats;
+            }
+
+            /**
+             * @brief Result type of median() and percentile(): double for arithmetic T, T otherwise.
+             */
+            using quantile_type = std::conditional_t<std::is_arithmetic_v<T>, double, T>;
+
+            /**
+             * @brief Returns the smallest element.
+             *
+             * O(1): add() keeps the extremes current. After remove() deletes an extreme they
+             * are recomputed on the next call from the sorted snapshot if it is ready,
+             * otherwise with a single SIMD-friendly min/max pass.
+             *
+             * @return T A copy of the smallest element
+             * @throws std::runtime_error If the container is empty
+             */
+            T min() const {
+                if (items().empty()) {
+                    throw std::runtime_error("min: container is empty.");
+                }
+                return minMax().first;
+            }
+
+            /**
+             * @brief Returns the largest element (same costs as min()).
+             *
+             * @return T A copy of the largest element
+             * @throws std::runtime_error If the container is empty
+             */
+            T max() const {
+                if (items().empty()) {
+                    throw std::runtime_error("max: container is empty.");
+                }
+                return minMax().second;
+            }
+
+            /**
+             * @brief Returns the smallest and largest elements.
+             *
+             * Uses the extremes kept by add() when they are known; otherwise one vectorized
+             * pass, split into blocks across threads for large containers.
+             *
+             * @param threads Threads for the recomputing pass (0 = hardware concurrency)
+             * @return std::pair<T, T> (min, max)
+             * @throws std::runtime_error If the container is empty
+             */
+            std::pair<T, T> minmax(size_t threads = 1) const {
+                if (items().empty()) {
+                    throw std::runtime_error("minmax: container is empty.");
+                }
+                return minMax(threads);
+            }
+
+            /**
+             * @brief Returns the sum of all elements (0 when empty).
+             *
+             * Each reduce_block-sized block is summed with eight vectorized accumulators and
+             * the block sums are added in order, so floating-point results are identical for
+             * every thread count.
+             *
+             * @param threads Threads to split the blocks across (0 = hardware concurrency)
+             * @return sum_type The sum
+             */
+            sum_type sum(size_t threads = 1) const requires std::is_arithmetic_v<T> {
+                sum_type total = 0;
+                for (sum_type part : blockReduce(threads, sumBlock)) {
+                    total += part;
+                }
+                return total;
+            }
+
+            /**
+             * @brief Returns the arithmetic mean.
+             *
+             * @param threads Threads to split the blocks across (0 = hardware concurrency)
+             * @return double sum() / size()
+             * @throws std::runtime_error If the container is empty
+             */
+            double mean(size_t threads = 1) const requires std::is_arithmetic_v<T> {
+                if (items().empty()) {
+                    throw std::runtime_error("mean: container is empty.");
+                }
+                return static_cast<double>(sum(threads)) / static_cast<double>(items().size());
+            }
+
+            /**
+             * @brief Returns the population variance (divides by size()).
+             *
+             * Two passes: mean(), then the blocked sum of squared deviations, which avoids
+             * the cancellation of the sum-of-squares formula. Deterministic like sum().
+             *
+             * @param threads Threads to split the blocks across (0 = hardware concurrency)
+             * @return double The variance
+             * @throws std::runtime_error If the container is empty
+             */
+            double variance(size_t threads = 1) const requires std::is_arithmetic_v<T> {
+                if (items().empty()) {
+                    throw std::runtime_error("variance: container is empty.");
+                }
+                const double mu = mean(threads);
+                double total = 0;
+                for (double part : blockReduce(threads, [mu](const T* p, size_t n) { return squaredDeviationBlock(p, n, mu); })) {
+                    total += part;
+                }
+                return total / static_cast<double>(items().size());
+            }
+
+            /**
+             * @brief Starts maintaining a KLL quantile sketch for approx_percentile().
+             *
+             * add() then updates the sketch in amortized O(log k) and queries never sort
+             * the container. A KLL sketch cannot delete, so a remove() marks it stale and the
+             * next query rebuilds it from the elements.
+             *
+             * The rank error is about 2.296 / k^0.9723 of the element count: 200 gives about 1.3%,
+             * 1000 about 0.28%. Use enable_quantile_sketch_with_error() to pick k from a target error.
+             *
+             * @param k Sketch accuracy (see KllSketch; 200 gives about 1.3% rank error)
+             */
+            void enable_quantile_sketch(size_t k = 200) {
+                sketchK = k;
+                sketch.emplace(k);
+                for (const T& value : items()) {
+                    sketch->update(value);
+                }
+                sketchStale = false;
+            }
+
+            /**
+             * @brief Starts maintaining a quantile sketch whose rank error is about epsilon.
+             *
+             * @param epsilon Target normalized rank error, in (0, 1)
+             * @throws std::invalid_argument If epsilon is not in (0, 1)
+             */
+            void enable_quantile_sketch_with_error(double epsilon) {
+                enable_quantile_sketch(KllSketch<T>::accuracy_for_error(epsilon));
+            }
+
+            /**
+             * @brief Drops the quantile sketch.
+             */
+            void disable_quantile_sketch() {
+                sketch.reset();
+                sketchStale = false;
+            }
+
+            /**
+             * @brief Returns true if a quantile sketch is maintained.
+             */
+            bool quantile_sketch_enabled() const {
+                return sketch.has_value();
+            }
+
+            /**
+             * @brief Returns the sketch, e.g. to merge the sketches of several containers.
+             *
+             * @throws std::runtime_error If the sketch is not enabled
+             */
+            const KllSketch<T>& quantile_sketch() const {
+                if (!sketch) {
+                    throw std::runtime_error("approx_percentile: quantile sketch is not enabled.");
+                }
+                return currentSketch();
+            }
+
+            /**
+             * @brief Returns an element whose rank is within the sketch's error of p percent.
+             *
+             * Answered from the sketch alone in O(k) (O(log k) when queried repeatedly
+             * without writes in between).
+             *
+             * @param p Percentile in [0, 100]
+             * @return T An element of approximately that rank
+             * @throws std::runtime_error If the sketch is not enabled, the container is empty or p is outside [0, 100]
+             */
+            T approx_percentile(double p) const {
+                const KllSketch<T>& s = quantile_sketch();
+                if (items().empty()) {
+                    throw std::runtime_error("approx_percentile: container is empty.");
+                }
+                if (!(p >= 0 && p <= 100)) {
+                    throw std::runtime_error("approx_percentile: p must be within [0, 100].");
+                }
+                return s.quantile(p / 100);
+            }
+
+            /**
+             * @brief Returns the k-th smallest element (k = 0 is the minimum).
+             *
+             * Reads the sorted snapshot in O(1) when it is available; otherwise selects
+             * with std::nth_element on a copy in O(n) without building the snapshot.
+             *
+             * @param k Zero-based position in ascending order
+             * @return T A copy of the element
+             * @throws std::runtime_error If k >= size()
+             */
+            T kth_smallest(size_t k) const {
+                if (k >= size()) {
+                    throw std::runtime_error("kth_smallest: k out of range.");
+                }
+                if (auto sorted = readySorted()) {
+                    return (*sorted)[k];
+                }
+                std::vector<T> scratch(items());
+                std::nth_element(scratch.begin(), scratch.begin() + k, scratch.end());
+                return scratch[k];
+            }
+
+            /**
+             * @brief Returns the p-th percentile, p in [0, 100].
+             *
+             * For arithmetic T the result interpolates linearly between the two closest
+             * ranks; otherwise it is the element at the lower of the two ranks.
+             *
+             * @param p The percentile
+             * @return quantile_type The percentile value
+             * @throws std::runtime_error If the container is empty or p is outside [0, 100]
+             */
+            quantile_type percentile(double p) const {
+                return percentiles(std::span<const double>(&p, 1)).front();
+            }
+
+            /**
+             * @brief Returns the median (the 50th percentile).
+             *
+             * @throws std::runtime_error If the container is empty
+             */
+            quantile_type median() const {
+                return percentile(50.0);
+            }
+
+            /**
+             * @brief Returns many percentiles at once.
+             *
+             * Uses the sorted snapshot when available. Otherwise one copy of the data is
+             * partitioned once for all requested ranks (see multiSelect) rather than once
+             * per percentile.
+             *
+             * @param ps Percentiles in [0, 100], in any order
+             * @return std::vector<quantile_type> Results in the same order as ps
+             * @throws std::runtime_error If the container is empty or any p is outside [0, 100]
+             */
+            std::vector<quantile_type> percentiles(std::span<const double> ps) const {
+                const size_t n = size();
+                if (n == 0) {
+                    throw std::runtime_error("percentile: container is empty.");
+                }
+                std::vector<size_t> ranks; // lower and upper rank of every percentile
+                ranks.reserve(ps.size() * 2);
+                for (double p : ps) {
+                    if (!(p >= 0.0 && p <= 100.0)) {
+                        throw std::runtime_error("percentile: p must be within [0, 100].");
+                    }
+                    const double pos = p / 100.0 * static_cast<double>(n - 1);
+                    ranks.push_back(static_cast<size_t>(pos));
+                    ranks.push_back(std::min(n - 1, static_cast<size_t>(pos) + 1));
+                }
+
+                std::shared_ptr<const std::vector<T>> sorted = readySorted();
+                std::vector<T> scratch;
+                if (!sorted) {
+                    std::vector<size_t> wanted(ranks);
+                    std::sort(wanted.begin(), wanted.end());
+                    wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+                    scratch = items();
+                    multiSelect(scratch.begin(), scratch.end(), wanted.data(), wanted.data() + wanted.size(), 0);
+                }
+                const std::vector<T>& ordered = sorted ? *sorted : scratch;
+
+                std::vector<quantile_type> out;
+                out.reserve(ps.size());
+                for (size_t i = 0; i < ps.size(); ++i) {
+                    const T& lo = ordered[ranks[2 * i]];
+                    if constexpr (std::is_arithmetic_v<T>) {
+                        const double pos = ps[i] / 100.0 * static_cast<double>(n - 1);
+                        const double frac = pos - static_cast<double>(ranks[2 * i]);
+                        const double hi = static_cast<double>(ordered[ranks[2 * i + 1]]);
+                        out.push_back(static_cast<double>(lo) + frac * (hi - static_cast<double>(lo)));
+                    } else {
+                        out.push_back(lo);
+                    }
+                }
+                return out;
+            }
+
+            /**
+             * @brief Returns the k largest elements, largest first.
+             *
+             * O(k) from the sorted snapshot when it is available; otherwise an O(n log k)
+             * bounded-heap scan (block-filtered for arithmetic T) without sorting.
+             *
+             * @param k Number of elements wanted (clamped to size())
+             * @return std::vector<T> The k largest elements in descending order
+             */
+            std::vector<T> top_k(size_t k) const {
+                if (auto sorted = readySorted()) {
+                    k = std::min(k, sorted->size());
+                    return std::vector<T>(sorted->rbegin(), sorted->rbegin() + k);
+                }
+                return selectK(items(), k, greaterThan);
+            }
+
+            /**
+             * @brief Returns the k smallest elements, smallest first.
+             *
+             * Same strategy as top_k().
+             *
+             * @param k Number of elements wanted (clamped to size())
+             * @return std::vector<T> The k smallest elements in ascending order
+             */
+            std::vector<T> bottom_k(size_t k) const {
+                if (auto sorted = readySorted()) {
+                    k = std::min(k, sorted->size());
+                    return std::vector<T>(sorted->begin(), sorted->begin() + k);
+                }
+                return selectK(items(), k, lessThan);
+            }
 
-        public:
-    
             /**
-             * @brief Default constructor.
-             * 
-             * Creates an empty container with no elements.
+             * @brief Starts maintaining the k largest elements incrementally.
+             *
+             * add() then keeps them current in O(log k). A remove() that may delete a
+             * tracked value marks the set stale; it is recomputed on the next tracked_top_k().
+             *
+             * @param k Number of largest elements to track (0 stops tracking)
              */
-            MyContainer() = default;
+            void track_top_k(size_t k) {
+                topTracker = TopKTracker{};
+                topTracker.k = k;
+                if (k != 0) {
+                    topTracker.heap = selectK(items(), k, greaterThan);
+                    std::make_heap(topTracker.heap.begin(), topTracker.heap.end(), greaterThan);
+                }
+            }
 
             /**
-             * @brief Default destructor.
-             * 
-             * Automatically cleans up all stored elements.
+             * @brief Returns the tracked k largest elements, largest first.
+             *
+             * @return std::vector<T> Up to k elements in descending order
+             * @throws std::runtime_error If track_top_k() has not been enabled
              */
-            ~MyContainer() = default;
-            
+            std::vector<T> tracked_top_k() const {
+                std::lock_guard<std::mutex> lock(cacheMutex.m);
+                TopKTracker& t = topTracker;
+                if (t.k == 0) {
+                    throw std::runtime_error("tracked_top_k: tracking is not enabled.");
+                }
+                if (t.stale) {
+                    t.heap = selectK(items(), t.k, greaterThan);
+                    std::make_heap(t.heap.begin(), t.heap.end(), greaterThan);
+                    t.stale = false;
+                }
+                std::vector<T> out(t.heap);
+                std::sort_heap(out.begin(), out.end(), greaterThan);
+                return out;
+            }
+
             /**
-             * @brief Adds an element to the container.
-             * 
-             * @param value The value to add to the container (passed by const reference)
+             * @brief Returns the number of elements strictly smaller than value.
+             *
+             * O(log n) binary search on the sorted snapshot when it is available,
+             * otherwise an O(n) counting scan (no sort).
+             *
+             * @param value The value to rank
+             * @return size_t Zero-based ascending position value would be inserted at
              */
-            void add(const T& value) {
-                data.push_back(value);
+            size_t rank(const T& value) const {
+                if (auto sorted = readySorted()) {
+                    return static_cast<size_t>(std::lower_bound(sorted->begin(), sorted->end(), value) - sorted->begin());
+                }
+                const std::vector<T>& current = items();
+                return static_cast<size_t>(std::count_if(current.begin(), current.end(),
+                                                         [&value](const T& x) { return x < value; }));
             }
 
             /**
-             * @brief Removes all occurrences of a specific value from the container.
-             * 
-             * This method removes every instance of the specified value found in the container.
-             * If the value is not found, it throws a runtime_error exception.
-             * 
-             * @param value The value to remove from the container (passed by const reference)
-             * @throws std::runtime_error If the element is not found in the container
+             * @brief Returns the number of elements in [lo, hi).
+             *
+             * Two binary searches on the sorted snapshot, O(log n) once it exists.
+             *
+             * @param lo Inclusive lower bound
+             * @param hi Exclusive upper bound
+             * @return size_t Number of elements x with lo <= x < hi (0 if hi <= lo)
              */
-            void remove(const T& value) {
-                bool found = false;
-                for (auto it = data.begin(); it != data.end(); ) {
-                    if (*it == value) {
-                        it = data.erase(it); 
-                        found = true;
-                    } else {
-                        ++it;
-                    }
-                }        
-                if (!found) {
-                    throw std::runtime_error("Element not found in container.");
+            size_t count_in_range(const T& lo, const T& hi) const {
+                return ascending_range(lo, hi).size();
+            }
+
+            /**
+             * @brief Returns the elements in [lo, hi) in ascending order, without copying them.
+             *
+             * The range is a slice of the sorted snapshot located by binary search, so only
+             * the matching elements are visited.
+             *
+             * @param lo Inclusive lower bound
+             * @param hi Exclusive upper bound
+             * @return SortedRange<T> View of the matching slice (empty if hi <= lo)
+             */
+            SortedRange<T> ascending_range(const T& lo, const T& hi) const {
+                std::shared_ptr<const std::vector<T>> sorted = sortedSnapshot();
+                auto first = std::lower_bound(sorted->begin(), sorted->end(), lo);
+                auto last = first;
+                if (lo < hi) {
+                    last = std::lower_bound(first, sorted->end(), hi);
                 }
+                const size_t offset = static_cast<size_t>(first - sorted->begin());
+                const size_t count = static_cast<size_t>(last - first);
+                return SortedRange<T>(std::move(sorted), offset, count);
             }
 
             /**
-             * @brief Returns the number of elements in the container.
-             * 
-             * @return size_t The current size of the container
+             * @brief Returns every element in ascending order, without copying them.
+             *
+             * O(1) when the sorted snapshot is cached; otherwise it is built (and cached) first.
+             *
+             * @return SortedRange<T> View of the whole sorted snapshot
              */
-            size_t size() const {
-                return data.size();
+            SortedRange<T> ascending_view() const {
+                std::shared_ptr<const std::vector<T>> sorted = sortedSnapshot();
+                const size_t count = sorted->size();
+                return SortedRange<T>(std::move(sorted), 0, count);
             }
   
             /**
@@ -89,9 +2295,261 @@ namespace container {
              * @return const std::vector<T>& A const reference to the internal data vector
              */
             const std::vector<T>& getData() const { //for testing
-                return data;
+                return items();
+            }
+
+            /**
+             * @brief Zero-copy read-only view of the elements in insertion order.
+             *
+             * The view points directly at the contiguous internal storage, so it can be
+             * passed to SIMD or BLAS style routines as a pointer and length. It is
+             * invalidated by add() and remove().
+             *
+             * @return std::span<const T> View over the insertion-ordered elements
+             */
+            std::span<const T> as_span() const {
+                return std::span<const T>(items().data(), items().size());
+            }
+
+            /**
+             * @brief Zero-copy read-only view of the elements in reverse insertion order.
+             *
+             * Same lifetime rules as as_span().
+             *
+             * @return ReverseSpan<T> View whose element 0 is the last inserted element
+             */
+            ReverseSpan<T> as_reverse_span() const {
+                return ReverseSpan<T>(as_span());
             }
             
+        /**
+         * @brief Prints the elements in the given order as "[ a, b, c ]" to a C stream.
+         *
+         * Formats into a 64 KB buffer with std::to_chars and writes it with one fwrite
+         * per full buffer.
+         *
+         * @param file Destination stream
+         * @param order The traversal order
+         * @throws std::runtime_error If a write fails
+         */
+        void write_to(std::FILE* file, Order order = Order::Normal) const {
+            auto sink = [file](const char* p, size_t n) {
+                if (std::fwrite(p, 1, n, file) != n) {
+                    throw std::runtime_error("write_to: write failed.");
+                }
+            };
+            writeFormatted(order, sink, 6);
+        }
+
+#if __has_include(<unistd.h>)
+        /**
+         * @brief Prints the elements in the given order as "[ a, b, c ]" to a file descriptor.
+         *
+         * @param fd Destination descriptor
+         * @param order The traversal order
+         * @throws std::runtime_error If a write fails
+         */
+        void write_to(int fd, Order order = Order::Normal) const {
+            auto sink = [fd](const char* p, size_t n) {
+                while (n > 0) {
+                    const ssize_t written = ::write(fd, p, n);
+                    if (written < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error("write_to: write failed.");
+                    }
+                    p += written;
+                    n -= static_cast<size_t>(written);
+                }
+            };
+            writeFormatted(order, sink, 6);
+        }
+#endif
+
+        /**
+         * @brief Writes the container in the binary format (see container::binary).
+         *
+         * Elements are stored in insertion order: trivially copyable T as one raw
+         * little-endian block, std::string as length-prefixed bytes. With
+         * withSortedIndex the sort permutation is stored as well (an O(n log n)
+         * argsort at save time), so load_binary() restores the sorted snapshot and
+         * the first sorted traversal after loading does not sort.
+         *
+         * @param os Destination stream (opened in binary mode)
+         * @param withSortedIndex Also store the checksummed sort permutation
+         * @throws std::runtime_error If writing fails
+         */
+        void save_binary(std::ostream& os, bool withSortedIndex = false) const {
+            binary::Header h;
+            h.tag = binary::type_tag<T>();
+            h.elementSize = std::is_same_v<T, std::string> ? 0 : static_cast<uint32_t>(sizeof(T));
+            h.flags = withSortedIndex ? binary::flag_sorted_index : 0;
+            h.count = items().size();
+            binary::write_header(os, h);
+            binary::write_elements<T>(os, as_span());
+            if (withSortedIndex) {
+                binary::write_sorted_index<T>(os, as_span());
+            }
+            if (!os) {
+                throw std::runtime_error("save_binary: write failed.");
+            }
+        }
+
+        /**
+         * @brief Writes the container to a file in the binary format.
+         *
+         * @param path The file to create or overwrite
+         * @param withSortedIndex Also store the checksummed sort permutation
+         * @throws std::runtime_error If the file cannot be written
+         */
+        void save_binary(const std::string& path, bool withSortedIndex = false) const {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                throw std::runtime_error("save_binary: cannot open " + path);
+            }
+            save_binary(out, withSortedIndex);
+        }
+
+        /**
+         * @brief Reads a container written by save_binary().
+         *
+         * A stored sort permutation is applied in O(n) and installed as the sorted
+         * snapshot.
+         *
+         * @param is Source stream (opened in binary mode)
+         * @return MyContainer The loaded container
+         * @throws std::runtime_error If the data is not a container file of this element type, is truncated,
+         *         or its sort permutation fails the checksum
+         */
+        static MyContainer load_binary(std::istream& is) {
+            unsigned char bytes[binary::header_size];
+            if (!is.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+                throw std::runtime_error("load_binary: file is truncated.");
+            }
+            binary::Header h = binary::parse_header<T>(bytes);
+            MyContainer result;
+            std::vector<T> values = binary::read_elements<T>(is, h.count);
+            if (!values.empty()) {
+                if (h.flags & binary::flag_sorted_index) {
+                    result.sortedCache = std::make_shared<const std::vector<T>>(binary::read_sorted_index(is, values));
+                }
+                result.data = std::make_shared<std::vector<T>>(std::move(values));
+            }
+            return result;
+        }
+
+        /**
+         * @brief Reads a container file written by save_binary().
+         *
+         * @param path The file to read
+         * @return MyContainer The loaded container
+         * @throws std::runtime_error If the file cannot be read or does not match
+         */
+        static MyContainer load_binary(const std::string& path) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                throw std::runtime_error("load_binary: cannot open " + path);
+            }
+            return load_binary(in);
+        }
+
+        /**
+         * @brief Loads the numbers of a delimiter- or newline-separated text file.
+         *
+         * The file is memory-mapped and cut into one chunk per thread at separator
+         * boundaries; each chunk is parsed with std::from_chars into its own buffer and
+         * the buffers are concatenated into storage allocated once for the total.
+         * Whitespace (including newlines) also separates numbers and empty fields are skipped.
+         *
+         * @param path The file to read
+         * @param delimiter Field separator, e.g. '\n' or ','
+         * @param threads Number of parsing threads (0 = hardware concurrency)
+         * @return MyContainer The numbers in file order
+         * @throws std::runtime_error If the file cannot be read or a field is not a number
+         */
+        static MyContainer load_text(const std::string& path, char delimiter = '\n', size_t threads = 0)
+            requires detail::to_chars_number<T> {
+            detail::MappedFile file;
+            try {
+                file = detail::MappedFile(path, true);
+            } catch (const std::runtime_error& e) {
+                throw std::runtime_error(std::string("load_text: ") + e.what());
+            }
+            const char* text = file.data();
+            const size_t n = file.size();
+            if (threads == 0) {
+                threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+            // below 1 MB per thread the start-up cost outweighs the parsing
+            threads = std::max<size_t>(1, std::min(threads, n >> 20));
+            std::vector<const char*> cuts{text};
+            for (size_t t = 1; t < threads; ++t) {
+                const char* cut = std::max(text + n / threads * t, cuts.back());
+                while (cut != text + n && !detail::is_text_separator(*cut, delimiter)) {
+                    ++cut;
+                }
+                cuts.push_back(cut);
+            }
+            cuts.push_back(text + n);
+
+            std::vector<std::vector<T>> parts(threads);
+            std::vector<std::exception_ptr> errors(threads);
+            auto work = [&](size_t t) {
+                try {
+                    detail::parse_text_chunk(cuts[t], cuts[t + 1], delimiter, text, parts[t]);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            };
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < threads; ++t) {
+                workers.emplace_back(work, t);
+            }
+            work(0);
+            for (auto& w : workers) {
+                w.join();
+            }
+            for (const auto& error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            MyContainer result;
+            size_t total = 0;
+            for (const auto& part : parts) {
+                total += part.size();
+            }
+            if (total == 0) {
+                return result;
+            }
+            if (threads == 1) {
+                result.data = std::make_shared<std::vector<T>>(std::move(parts[0]));
+                return result;
+            }
+            auto values = std::make_shared<std::vector<T>>();
+            values->reserve(total);
+            for (const auto& part : parts) {
+                values->insert(values->end(), part.begin(), part.end());
+            }
+            result.data = std::move(values);
+            return result;
+        }
+
+#if CONTAINER_HAS_MMAP
+        /**
+         * @brief Opens a container file as a zero-copy, read-only memory-mapped view.
+         *
+         * @param path The file to map
+         * @return MappedContainer<T> View over the elements in place
+         * @throws std::runtime_error If the file cannot be mapped or does not match
+         */
+        static MappedContainer<T> map_binary(const std::string& path) {
+            return MappedContainer<T>(path);
+        }
+#endif
+
         /**
          * @brief Stream insertion operator for printing the container.
          * 
@@ -102,10 +2560,21 @@ namespace container {
          * @return std::ostream& Reference to the output stream for chaining
          */
         friend std::ostream& operator<<(std::ostream& os, const MyContainer<T>& container) {
+            // buffered to_chars path unless the stream has formatting state (flags, width, locale) it would ignore
+            constexpr auto defaultFlags = std::ios_base::skipws | std::ios_base::dec;
+            if constexpr (detail::to_chars_number<T> || std::is_convertible_v<const T&, std::string_view>) {
+                if (os.width() == 0 && (!detail::to_chars_number<T>
+                                        || (os.flags() == defaultFlags && os.getloc() == std::locale::classic()))) {
+                    auto sink = [&os](const char* p, size_t n) { os.write(p, static_cast<std::streamsize>(n)); };
+                    container.writeFormatted(Order::Normal, sink, static_cast<int>(os.precision()));
+                    return os;
+                }
+            }
             os << "[ ";
-            for (size_t i = 0; i < container.data.size(); ++i) {
-                os << container.data[i];
-                if (i + 1 < container.data.size()) {
+            const std::vector<T>& elements = container.items();
+            for (size_t i = 0; i < elements.size(); ++i) {
+                os << elements[i];
+                if (i + 1 < elements.size()) {
                     os << ", ";
                 }
             }
@@ -118,13 +2587,13 @@ namespace container {
     /**
      * @brief Iterator class for traversing elements in ascending sorted order.
      * 
-     * This iterator creates a sorted copy of the container data and allows
-     * forward iteration through elements in ascending order. The original
+     * This iterator walks the container's cached sorted snapshot (a sorted copy
+     * of the container data) forward, in ascending order. The original
      * container data remains unchanged.
      */
     class AscendingIterator {
     private:
-        std::vector<T> sortedData; ///< Sorted copy of the container data
+        std::shared_ptr<const std::vector<T>> sortedData; ///< Shared sorted snapshot of the container data
         size_t index; ///< Current position in the sorted data
         
     public:
@@ -132,25 +2601,20 @@ namespace container {
          * @brief Constructor for begin() iterator.
          * 
          * Creates an iterator pointing to the smallest element in the container.
-         * Makes a copy of the original data and sorts it in ascending order.
          * 
-         * @param originalData The container's data vector to iterate over
+         * @param sorted The container's ascending sorted snapshot
          */
-        AscendingIterator(const std::vector<T>& originalData):sortedData(originalData), index(0) {
-            std::sort(sortedData.begin(), sortedData.end());
-        }
+        AscendingIterator(std::shared_ptr<const std::vector<T>> sorted):sortedData(std::move(sorted)), index(0) {}
 
         /**
          * @brief Constructor for end() iterator.
          * 
          * Creates an iterator representing the end position for comparison purposes.
          * 
-         * @param originalData The container's data vector
+         * @param sorted The container's ascending sorted snapshot
          * @param endIndex The index representing the end position (typically size())
          */
-        AscendingIterator(const std::vector<T>& originalData, size_t endIndex):sortedData(originalData), index(endIndex) {
-            std::sort(sortedData.begin(), sortedData.end());
-        }
+        AscendingIterator(std::shared_ptr<const std::vector<T>> sorted, size_t endIndex):sortedData(std::move(sorted)), index(endIndex) {}
         
         /**
          * @brief Dereference operator to access current element.
@@ -159,10 +2623,10 @@ namespace container {
          * @throws std::runtime_error If attempting to dereference beyond the end
          */
         const T& operator*() const {
-            if (index >= sortedData.size()) {
-                throw std::runtime_error("Attempted to desourceerence AscendingIterator beyond the end.");
+            if (index >= sortedData->size()) {
+                throw std::runtime_error("Attempted to dereference AscendingIterator beyond the end.");
             }
-            return sortedData.at(index);
+            return sortedData->at(index);
         }
 
         /**
@@ -172,7 +2636,7 @@ namespace container {
          * @throws std::runtime_error If attempting to increment past the end
          */
         AscendingIterator& operator++() {
-            if (index >= sortedData.size()) {
+            if (index >= sortedData->size()) {
                 throw std::runtime_error("Cannot increment - AscendingIterator past the end.");
             }
             ++index;
@@ -186,7 +2650,8 @@ namespace container {
          * @return bool True if iterators are not equal, false otherwise
          */
         bool operator!=(const AscendingIterator& other) const {
-            return index != other.index || sortedData != other.sortedData;
+            // same snapshot is the O(1) common case; different snapshots fall back to comparing contents
+            return index != other.index || (sortedData != other.sortedData && *sortedData != *other.sortedData);
         }
         
         /**
@@ -206,7 +2671,7 @@ namespace container {
      * @return AscendingIterator Iterator pointing to the smallest element
      */
     AscendingIterator begin_ascending_order() const {
-        return AscendingIterator(data);
+        return AscendingIterator(sortedSnapshot());
     }
     
     /**
@@ -215,45 +2680,40 @@ namespace container {
      * @return AscendingIterator Iterator representing the end position
      */
     AscendingIterator end_ascending_order() const {
-        return AscendingIterator(data, data.size());
+        return AscendingIterator(sortedSnapshot(), size());
     }
     
     /**
      * @brief Iterator class for traversing elements in descending sorted order.
      * 
-     * This iterator creates a sorted copy of the container data in descending order
-     * and allows forward iteration through elements from largest to smallest.
+     * This iterator walks the container's cached ascending sorted snapshot backwards,
+     * iterating through elements from largest to smallest.
      * The original container data remains unchanged.
      */
     class DescendingIterator {
     private:
-        std::vector<T> sortedData; ///< Sorted copy of the container data in descending order
-        size_t index; ///< Current position in the sorted data
+        std::shared_ptr<const std::vector<T>> sortedData; ///< Shared ascending sorted snapshot of the container data
+        size_t index; ///< Current position counted from the largest element
 
     public:
         /**
          * @brief Constructor for begin() iterator.
          * 
          * Creates an iterator pointing to the largest element in the container.
-         * Makes a copy of the original data and sorts it in descending order.
          * 
-         * @param originalData The container's data vector to iterate over
+         * @param sorted The container's ascending sorted snapshot
          */
-        DescendingIterator(const std::vector<T>& originalData): sortedData(originalData), index(0) {
-            std::sort(sortedData.begin(), sortedData.end(), std::greater<T>());
-        }
+        DescendingIterator(std::shared_ptr<const std::vector<T>> sorted): sortedData(std::move(sorted)), index(0) {}
 
         /**
          * @brief Constructor for end() iterator.
          * 
          * Creates an iterator representing the end position for comparison purposes.
          * 
-         * @param originalData The container's data vector
+         * @param sorted The container's ascending sorted snapshot
          * @param endIndex The index representing the end position (typically size())
          */
-        DescendingIterator(const std::vector<T>& originalData, size_t endIndex): sortedData(originalData), index(endIndex) {
-            std::sort(sortedData.begin(), sortedData.end(), std::greater<T>());
-        }
+        DescendingIterator(std::shared_ptr<const std::vector<T>> sorted, size_t endIndex): sortedData(std::move(sorted)), index(endIndex) {}
 
         /**
          * @brief Dereference operator to access current element.
@@ -262,10 +2722,10 @@ namespace container {
          * @throws std::runtime_error If attempting to dereference beyond the end
          */
         const T& operator*() const {
-            if (index >= sortedData.size()) {
-                throw std::runtime_error("Attempted to desourceerence - DescendingIterator beyond the end.");
+            if (index >= sortedData->size()) {
+                throw std::runtime_error("Attempted to dereference - DescendingIterator beyond the end.");
             }
-            return sortedData.at(index);
+            return (*sortedData)[sortedData->size() - 1 - index];
         }
 
         /**
@@ -275,7 +2735,7 @@ namespace container {
          * @throws std::runtime_error If attempting to increment past the end
          */
         DescendingIterator& operator++() {
-            if (index >= sortedData.size()) {
+            if (index >= sortedData->size()) {
                 throw std::runtime_error("Cannot increment - DescendingIterator past the end.");
             }
             ++index;
@@ -289,7 +2749,7 @@ namespace container {
          * @return bool True if iterators are not equal, false otherwise
          */
         bool operator!=(const DescendingIterator& other) const {
-            return index != other.index || sortedData != other.sortedData;
+            return index != other.index || (sortedData != other.sortedData && *sortedData != *other.sortedData);
         }
 
         /**
@@ -309,7 +2769,7 @@ namespace container {
      * @return DescendingIterator Iterator pointing to the largest element
      */
     DescendingIterator begin_descending_order() const {
-        return DescendingIterator(data);
+        return DescendingIterator(sortedSnapshot());
     }
     
     /**
@@ -318,19 +2778,27 @@ namespace container {
      * @return DescendingIterator Iterator representing the end position
      */
     DescendingIterator end_descending_order() const {
-        return DescendingIterator(data, data.size());
+        return DescendingIterator(sortedSnapshot(), size());
     }
 
     /**
      * @brief Iterator class for traversing elements alternating between smallest and largest values.
      * 
-     * This iterator creates a sorted copy of the container data and alternates between
+     * This iterator walks the container's cached sorted snapshot and alternates between
      * picking elements from the left (smallest) and right (largest) sides.
      * Pattern: smallest, largest, second smallest, second largest, etc.
+     *
+     * begin() only pins the container's storage, which is O(1) since it is copy-on-write.
+     * The first two elements are the container's min() and max(), which are known
+     * without sorting, so the pinned storage is only sorted when the iterator moves past them
+     * (unless a sorted snapshot was already available at begin()).
      */
     class SideCrossIterator {
         private:
-            std::vector<T> sortedData; ///< Sorted copy of the container data
+            std::shared_ptr<const std::vector<T>> sortedData; ///< Sorted snapshot, null until it is needed
+            std::shared_ptr<const std::vector<T>> pinned; ///< Storage pinned by begin(), sorted on the first advance past the extremes
+            std::optional<std::pair<T, T>> ends; ///< (min, max) captured by begin() when no snapshot was ready
+            int count; ///< Number of elements in the container
             int left; ///< Index pointing to the left (smallest) side
             int right; ///< Index pointing to the right (largest) side
             bool leftSide; ///< Flag indicating which side to pick from next
@@ -343,13 +2811,12 @@ namespace container {
              * For begin(): starts with left=0, right=size-1
              * For end(): sets up termination conditions based on container size
              * 
-             * @param original_data The container's data vector to iterate over
+             * @param container The container to traverse
              * @param is_end True if this is an end iterator, false for begin iterator
              */
-            SideCrossIterator(const std::vector<T>& original_data, bool is_end = false)
-                : sortedData(original_data), left(0), right(0), leftSide(true) {
-                std::sort(sortedData.begin(), sortedData.end());
-                int n = static_cast<int>(sortedData.size());
+            SideCrossIterator(const MyContainer& container, bool is_end = false)
+                : count(static_cast<int>(container.size())), left(0), right(0), leftSide(true) {
+                int n = count;
                 if (is_end) {
                     size_t mid = n / 2;
                     if( n % 2 == 0){
@@ -363,6 +2830,17 @@ namespace container {
                 } else {
                     left = 0;
                     right = n - 1;
+                    // the iterator owns what it reads, so later changes to the container cannot invalidate it:
+                    // the storage is copy-on-write, so pinning it makes the container copy before its next write
+                    if (n > 0) {
+                        sortedData = container.readySorted();
+                        if (!sortedData) {
+                            ends = container.minMax();
+                            if (n > 2) {
+                                pinned = container.data;
+                            }
+                        }
+                    }
                 }
 
             }
@@ -375,12 +2853,15 @@ namespace container {
              */
             const T& operator*() const {
                 
-                int n = static_cast<int>(sortedData.size());
+                int n = count;
                 if (left > right || left >= n) {
-                    throw std::runtime_error("Cannot desourceerence SideCrossIterator: out of range");
+                    throw std::runtime_error("Cannot dereference SideCrossIterator: out of range");
+                }
+                if (!sortedData) {
+                    return leftSide ? ends->first : ends->second;
                 }
          
-                return leftSide ? sortedData[left] : sortedData[right];
+                return leftSide ? (*sortedData)[left] : (*sortedData)[right];
             }
         
             /**
@@ -393,7 +2874,7 @@ namespace container {
              * @throws std::runtime_error If attempting to increment past the end
              */
             SideCrossIterator& operator++() {
-                int n = static_cast<int>(sortedData.size());
+                int n = count;
                 if (left > right || left >= n) {
                     throw std::runtime_error("Cannot increment SideCrossIterator past the end.");
                 }
@@ -405,6 +2886,14 @@ namespace container {
                 }
         
                 leftSide = !leftSide;
+
+                // past min() and max(): sort the pinned storage now
+                if (!sortedData && left > 0 && right < n - 1 && left <= right) {
+                    auto fresh = std::make_shared<std::vector<T>>(*pinned);
+                    std::sort(fresh->begin(), fresh->end());
+                    sortedData = std::move(fresh);
+                    pinned.reset();
+                }
                 
                 return *this;
             }
@@ -417,7 +2906,7 @@ namespace container {
              */
             bool operator!=(const SideCrossIterator& other) const {
                
-                return left != other.left || right != other.right || sortedData != other.sortedData;
+                return left != other.left || right != other.right;
             }
 
             /**
@@ -438,7 +2927,7 @@ namespace container {
      * @return SideCrossIterator Iterator that alternates between smallest and largest elements
      */
     SideCrossIterator begin_side_cross_order() const {
-        return SideCrossIterator(data); 
+        return SideCrossIterator(*this);
     }
     
     /**
@@ -447,7 +2936,7 @@ namespace container {
      * @return SideCrossIterator Iterator representing the end position
      */
     SideCrossIterator end_side_cross_order() const {
-        return SideCrossIterator(data, true);
+        return SideCrossIterator(*this, true);
     }
 
     /**
@@ -484,7 +2973,7 @@ namespace container {
              */
             const T& operator*() const {
                 if (source_data.empty() || index == SIZE_MAX || index >= source_data.size()) {
-                    throw std::runtime_error("Cannot desourceerence ReverseIterator: out of range");
+                    throw std::runtime_error("Cannot dereference ReverseIterator: out of range");
                 }
                 return source_data[index];
             }
@@ -533,7 +3022,7 @@ namespace container {
      * @return ReverseIterator Iterator pointing to the last inserted element
      */
     ReverseIterator begin_reverse_order() const {
-        return ReverseIterator(data);
+        return ReverseIterator(items());
     }
     
     /**
@@ -542,7 +3031,7 @@ namespace container {
      * @return ReverseIterator Iterator representing the end position
      */
     ReverseIterator end_reverse_order() const {
-        return ReverseIterator(data, true);
+        return ReverseIterator(items(), true);
     }
         
     /**
@@ -577,7 +3066,7 @@ namespace container {
              */
             const T& operator*() const {
                 if (index >= source_data.size()) {
-                    throw std::runtime_error("Cannot desourceerence OrderIterator: out of range");
+                    throw std::runtime_error("Cannot dereference OrderIterator: out of range");
                 }
                 return source_data[index];
             }
@@ -623,7 +3112,7 @@ namespace container {
          * @return OrderIterator Iterator pointing to the first inserted element
          */
         OrderIterator begin_order() const {
-            return OrderIterator(data);
+            return OrderIterator(items());
         }
         
         /**
@@ -632,7 +3121,7 @@ namespace container {
          * @return OrderIterator Iterator representing the end position
          */
         OrderIterator end_order() const {
-            return OrderIterator(data, true);
+            return OrderIterator(items(), true);
         }
         
     /**
@@ -754,7 +3243,7 @@ namespace container {
      * @return MiddleOutIterator Iterator starting from the middle element(s)
      */
     MiddleOutIterator begin_middle_out_order() const {
-        return MiddleOutIterator(data);
+        return MiddleOutIterator(items());
     }
     
     /**
@@ -763,9 +3252,444 @@ namespace container {
      * @return MiddleOutIterator Iterator representing the end position
      */
     MiddleOutIterator end_middle_out_order() const {
-        return MiddleOutIterator(data, true);
+        return MiddleOutIterator(items(), true);
+    }
+
+    /**
+     * @brief Calls fn on every element in the order chosen at compile time.
+     *
+     * Each order gets its own specialized loop with no per-element branching on
+     * which side to take next. Normal and Reverse are plain index loops over the
+     * contiguous storage, so the compiler can inline fn and vectorize the loop.
+     * Sorted orders (Ascending, Descending, SideCross) walk the cached sorted snapshot.
+     *
+     * @tparam O The traversal order
+     * @tparam Fn Callable invoked as fn(const T&)
+     * @param fn The visitor to call for each element
+     */
+    template<Order O, typename Fn>
+    void visit(Fn&& fn) const {
+        if constexpr (O == Order::Ascending || O == Order::Descending || O == Order::SideCross) {
+            std::shared_ptr<const std::vector<T>> sorted = sortedSnapshot();
+            detail::visit_range<O>(sorted->data(), sorted->size(), fn);
+        } else {
+            detail::visit_range<O>(items().data(), items().size(), fn);
+        }
+    }
+
+    /**
+     * @brief Copies the elements, in the given order, to an output iterator.
+     *
+     * When T is trivially copyable and out is a T* the copy uses fast paths:
+     * memcpy for Normal and Ascending (from the sorted snapshot), reverse copy for Reverse and
+     * Descending, and dedicated two-stream gather loops for SideCross and MiddleOut.
+     * Other output iterators receive the elements one by one.
+     *
+     * @param order The traversal order
+     * @param out Destination; must have room for size() elements
+     * @return OutputIt Iterator past the last element written
+     */
+    template<typename OutputIt>
+    OutputIt copy_to(Order order, OutputIt out) const {
+        const std::vector<T>& source = items();
+        switch (order) {
+            case Order::Normal:    return copyRange<Order::Normal>(source.data(), source.size(), out);
+            case Order::Reverse:   return copyRange<Order::Reverse>(source.data(), source.size(), out);
+            case Order::MiddleOut: return copyRange<Order::MiddleOut>(source.data(), source.size(), out);
+            default: break;
+        }
+        std::shared_ptr<const std::vector<T>> sorted = sortedSnapshot();
+        switch (order) {
+            case Order::Ascending:  return copyRange<Order::Ascending>(sorted->data(), sorted->size(), out);
+            case Order::Descending: return copyRange<Order::Descending>(sorted->data(), sorted->size(), out);
+            case Order::SideCross:  return copyRange<Order::SideCross>(sorted->data(), sorted->size(), out);
+            default: throw std::invalid_argument("copy_to: unknown order");
+        }
+    }
+
+    /**
+     * @brief Returns the elements, in the given order, as a new vector.
+     *
+     * @param order The traversal order
+     * @return std::vector<T> The materialized sequence
+     */
+    std::vector<T> to_vector(Order order) const {
+        if (order == Order::Ascending) {
+            return *sortedSnapshot();
+        }
+        std::vector<T> result;
+        if constexpr (std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>) {
+            result.resize(size());
+            copy_to(order, result.data());
+        } else {
+            result.reserve(size());
+            copy_to(order, std::back_inserter(result));
+        }
+        return result;
+    }
+
+    /**
+     * @brief Type-erased range over the container in an order chosen at runtime.
+     *
+     * The order is resolved once, at construction, into a batch-fill function.
+     * Traversal then works in batches of element pointers: there is one indirect
+     * call per batch and the per-element loop contains no dispatch at all, so a
+     * runtime-selected order performs like the statically chosen visit loops.
+     *
+     * Normal, Reverse and MiddleOut ranges reference the container data directly
+     * and must not outlive it; sorted orders share the container's sorted snapshot.
+     */
+    class AnyOrderRange {
+        private:
+            using FillFn = size_t (*)(const T* base, size_t n, size_t pos, const T** out, size_t max);
+
+            std::shared_ptr<const std::vector<T>> sortedData; ///< Keeps the sorted snapshot alive (sorted orders only)
+            const T* base; ///< First element of the sequence the order is applied to
+            size_t count; ///< Number of elements in the range
+            Order kind; ///< The order chosen at construction
+            FillFn fill; ///< Batch-fill function for the chosen order
+
+            /**
+             * @brief Writes pointers to the elements at positions [pos, pos + max) of order O.
+             *
+             * @return size_t Number of pointers written (less than max only at the end)
+             */
+            template<Order O>
+            static size_t fillBatch(const T* base, size_t n, size_t pos, const T** out, size_t max) {
+                const size_t got = pos >= n ? 0 : std::min(max, n - pos);
+                for (size_t i = 0; i < got; ++i) {
+                    out[i] = base + detail::index_at<O>(pos + i, n);
+                }
+                return got;
+            }
+
+        public:
+            static constexpr size_t batch_size = 256; ///< Batch length used by for_each
+
+            /**
+             * @brief Constructs a range over data in the given order.
+             *
+             * @param data The container's data vector
+             * @param sorted The container's sorted snapshot (required for sorted orders, may be null otherwise)
+             * @param order The traversal order
+             */
+            AnyOrderRange(const std::vector<T>& data, std::shared_ptr<const std::vector<T>> sorted, Order order)
+                : base(data.data()), count(data.size()), kind(order), fill(nullptr) {
+                switch (order) {
+                    case Order::Ascending:  fill = &fillBatch<Order::Ascending>;  break;
+                    case Order::Descending: fill = &fillBatch<Order::Descending>; break;
+                    case Order::SideCross:  fill = &fillBatch<Order::SideCross>;  break;
+                    case Order::Reverse:    fill = &fillBatch<Order::Reverse>;    break;
+                    case Order::Normal:     fill = &fillBatch<Order::Normal>;     break;
+                    case Order::MiddleOut:  fill = &fillBatch<Order::MiddleOut>;  break;
+                    default: throw std::invalid_argument("AnyOrderRange: unknown order");
+                }
+                if (order == Order::Ascending || order == Order::Descending || order == Order::SideCross) {
+                    sortedData = std::move(sorted);
+                    base = sortedData->data();
+                }
+            }
+
+            /**
+             * @brief Returns the order chosen at construction.
+             */
+            Order order() const {
+                return kind;
+            }
+
+            /**
+             * @brief Returns the number of elements in the range.
+             */
+            size_t size() const {
+                return count;
+            }
+
+            /**
+             * @brief Fills out with pointers to the next elements starting at position pos.
+             *
+             * @param pos Position in the traversal to start from
+             * @param out Destination buffer for element pointers
+             * @param max Capacity of out
+             * @return size_t Number of pointers written, 0 once pos reaches size()
+             */
+            size_t next_batch(size_t pos, const T** out, size_t max) const {
+                return fill(base, count, pos, out, max);
+            }
+
+            /**
+             * @brief Calls fn(const T* const* items, size_t n) once per batch of elements.
+             */
+            template<typename Fn>
+            void for_each_batch(Fn&& fn) const {
+                const T* batch[batch_size];
+                for (size_t pos = 0; pos < count; ) {
+                    size_t got = fill(base, count, pos, batch, batch_size);
+                    fn(static_cast<const T* const*>(batch), got);
+                    pos += got;
+                }
+            }
+
+            /**
+             * @brief Calls fn(const T&) on every element in the chosen order.
+             */
+            template<typename Fn>
+            void for_each(Fn&& fn) const {
+                for_each_batch([&fn](const T* const* items, size_t n) {
+                    for (size_t i = 0; i < n; ++i) {
+                        fn(*items[i]);
+                    }
+                });
+            }
+    };
+
+    /**
+     * @brief Creates a range over the container in an order selected at runtime.
+     *
+     * @param order The traversal order
+     * @return AnyOrderRange Range that dispatches on the order once per batch
+     */
+    AnyOrderRange any_order(Order order) const {
+        const bool sorted = order == Order::Ascending || order == Order::Descending || order == Order::SideCross;
+        return AnyOrderRange(items(), sorted ? sortedSnapshot() : nullptr, order);
+    }
+
+    /**
+     * @brief Range over the container in a user-defined order.
+     *
+     * The order is given by a stateless index generator G: a type providing
+     * `static size_t index(size_t pos, size_t n)` that returns a permutation of
+     * [0, n) as pos goes from 0 to n - 1. If G declares `static constexpr bool sorted = true`
+     * the generator is applied to the ascending sorted data (the range shares the container's sorted snapshot);
+     * otherwise it is applied to the insertion-ordered data, which the range references
+     * and must not outlive.
+     *
+     * The generator call is resolved at compile time, so every loop is as tight as a
+     * built-in order loop. The range offers an iterator, a batch API and a parallel split.
+     *
+     * @tparam G The index generator
+     */
+    template<typename G>
+    class GeneratedRange {
+        private:
+            std::shared_ptr<const std::vector<T>> sortedData; ///< Keeps the sorted snapshot alive (sorted generators only)
+            const T* base; ///< First element of the sequence the generator indexes
+            size_t count; ///< Number of elements in the range
+
+        public:
+            /**
+             * @brief Forward iterator over a GeneratedRange.
+             */
+            class Iterator {
+                private:
+                    const GeneratedRange* range; ///< The range being traversed
+                    size_t pos; ///< Current position in the traversal
+
+                public:
+                    Iterator(const GeneratedRange* r, size_t p) : range(r), pos(p) {}
+
+                    /**
+                     * @brief Dereference operator to access current element.
+                     *
+                     * @return const T& Reference to the current element
+                     * @throws std::runtime_error If attempting to dereference when out of range
+                     */
+                    const T& operator*() const {
+                        if (pos >= range->count) {
+                            throw std::runtime_error("Cannot dereference GeneratedRange iterator: out of range");
+                        }
+                        return range->base[G::index(pos, range->count)];
+                    }
+
+                    /**
+                     * @brief Pre-increment operator to move to next element.
+                     *
+                     * @throws std::runtime_error If attempting to increment past the end
+                     */
+                    Iterator& operator++() {
+                        if (pos >= range->count) {
+                            throw std::runtime_error("Cannot increment GeneratedRange iterator past the end.");
+                        }
+                        ++pos;
+                        return *this;
+                    }
+
+                    bool operator!=(const Iterator& other) const {
+                        return pos != other.pos || range != other.range;
+                    }
+
+                    bool operator==(const Iterator& other) const {
+                        return !(*this != other);
+                    }
+            };
+
+            /**
+             * @brief Constructs a range applying generator G to data.
+             *
+             * @param data The container's data vector
+             * @param sorted The container's sorted snapshot (required for sorted generators, may be null otherwise)
+             */
+            GeneratedRange(const std::vector<T>& data, std::shared_ptr<const std::vector<T>> sorted)
+                : base(data.data()), count(data.size()) {
+                if constexpr (detail::uses_sorted_data<G>::value) {
+                    sortedData = std::move(sorted);
+                    base = sortedData->data();
+                }
+            }
+
+            /**
+             * @brief Returns the number of elements in the range.
+             */
+            size_t size() const {
+                return count;
+            }
+
+            Iterator begin() const {
+                return Iterator(this, 0);
+            }
+
+            Iterator end() const {
+                return Iterator(this, count);
+            }
+
+            /**
+             * @brief Calls fn(const T&) on the elements at positions [first, last).
+             *
+             * This is the unit of work of the parallel split; callers with their own
+             * thread pool can hand out disjoint position ranges directly.
+             */
+            template<typename Fn>
+            void for_each_in(size_t first, size_t last, Fn&& fn) const {
+                last = std::min(last, count);
+                for (size_t pos = first; pos < last; ++pos) {
+                    fn(base[G::index(pos, count)]);
+                }
+            }
+
+            /**
+             * @brief Calls fn(const T&) on every element in generator order.
+             */
+            template<typename Fn>
+            void for_each(Fn&& fn) const {
+                for_each_in(0, count, fn);
+            }
+
+            /**
+             * @brief Writes pointers to the elements at positions [pos, pos + max) into out.
+             *
+             * @return size_t Number of pointers written, 0 once pos reaches size()
+             */
+            size_t next_batch(size_t pos, const T** out, size_t max) const {
+                const size_t got = pos >= count ? 0 : std::min(max, count - pos);
+                for (size_t i = 0; i < got; ++i) {
+                    out[i] = base + G::index(pos + i, count);
+                }
+                return got;
+            }
+
+            /**
+             * @brief Splits the positions into contiguous parts and visits them on several threads.
+             *
+             * fn must be safe to call concurrently; each element is visited exactly once.
+             *
+             * @param fn Callable invoked as fn(const T&)
+             * @param threads Number of threads to use (0 picks std::thread::hardware_concurrency())
+             */
+            template<typename Fn>
+            void parallel_for_each(Fn&& fn, size_t threads = 0) const {
+                if (threads == 0) {
+                    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+                }
+                threads = std::min(threads, std::max<size_t>(1, count));
+                const size_t chunk = (count + threads - 1) / threads;
+                std::vector<std::thread> workers;
+                for (size_t t = 1; t < threads; ++t) {
+                    workers.emplace_back([this, &fn, t, chunk]() { for_each_in(t * chunk, (t + 1) * chunk, fn); });
+                }
+                for_each_in(0, chunk, fn);
+                for (auto& w : workers) {
+                    w.join();
+                }
+            }
+    };
+
+    /**
+     * @brief Creates a range traversing the container in the order given by generator G.
+     *
+     * @tparam G Stateless index generator (see GeneratedRange)
+     * @return GeneratedRange<G> The range
+     */
+    template<typename G>
+    GeneratedRange<G> generated() const {
+        if constexpr (detail::uses_sorted_data<G>::value) {
+            return GeneratedRange<G>(items(), sortedSnapshot());
+        } else {
+            return GeneratedRange<G>(items(), nullptr);
+        }
+    }
+
+    private:
+    /**
+     * @brief Writes fwd[0], back[0], fwd[1], back[-1], ... (2 * count elements) to out.
+     *
+     * Uses the SIMD shuffle kernels for 4- and 8-byte elements and a plain loop otherwise.
+     */
+    static void zipReversed(const T* fwd, const T* back, size_t count, T* out) {
+        if constexpr (simd::has_zip_kernels<T>) {
+            simd::zip_reversed(fwd, back, count, out);
+        } else {
+            for (size_t j = 0; j < count; ++j) {
+                out[2 * j] = fwd[j];
+                out[2 * j + 1] = *(back - j);
+            }
+        }
+    }
+
+    /**
+     * @brief Copies the sequence of order O over a contiguous buffer to out.
+     *
+     * For sorted orders the buffer must already be sorted in ascending order.
+     */
+    template<Order O, typename OutputIt>
+    static OutputIt copyRange(const T* p, size_t n, OutputIt out) {
+        constexpr bool rawCopy = std::is_trivially_copyable_v<T> && std::is_same_v<OutputIt, T*>;
+        if constexpr (O == Order::Normal || O == Order::Ascending) {
+            if constexpr (rawCopy) {
+                if (n > 0) {
+                    std::memcpy(out, p, n * sizeof(T));
+                }
+                return out + n;
+            } else {
+                return std::copy(p, p + n, out);
+            }
+        } else if constexpr (O == Order::Reverse || O == Order::Descending) {
+            return std::reverse_copy(p, p + n, out);
+        } else if constexpr (rawCopy && O == Order::SideCross) {
+            // even slots take the low half forward, odd slots the high half backward
+            const size_t half = n / 2;
+            if (half > 0) {
+                zipReversed(p, p + n - 1, half, out);
+            }
+            if (n % 2 == 1) {
+                out[n - 1] = p[half];
+            }
+            return out + n;
+        } else if constexpr (rawCopy && O == Order::MiddleOut) {
+            // even slots take the right half forward from the middle, odd slots the left half backward
+            const size_t mid = n / 2;
+            if (mid > 0) {
+                zipReversed(p + mid, p + mid - 1, mid, out);
+            }
+            if (n % 2 == 1) {
+                out[n - 1] = p[n - 1];
+            }
+            return out + n;
+        } else {
+            auto push = [&out](const T& value) { *out = value; ++out; };
+            detail::visit_range<O>(p, n, push);
+            return out;
+        }
     }
-       
+
 };
 
 
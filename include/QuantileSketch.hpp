@@ -0,0 +1,246 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace container {
+
+    /**
+     * @brief Mergeable KLL quantile sketch.
+     *
+     * Keeps a stack of compactors: level h holds items that each stand for 2^h inputs.
+     * When the sketch is over capacity, the lowest full level is sorted and every other
+     * item (starting at a random offset) is promoted to the next level, halving it.
+     * Capacities shrink geometrically towards the lower levels, so only O(k) items are
+     * retained however many are added, and the rank error of a quantile query is about
+     * normalized_rank_error() of the count with high probability.
+     *
+     * @tparam T The item type (needs operator<)
+     */
+    template<typename T>
+    class KllSketch {
+        private:
+            size_t k; ///< Capacity of the top level; larger k means smaller error
+            std::vector<std::vector<T>> levels; ///< levels[h] holds items of weight 2^h
+            size_t retainedCount = 0; ///< Items held over all levels
+            size_t capacityTotal = 0; ///< Sum of the level capacities
+            uint64_t count = 0; ///< Number of items added (including merged sketches)
+            uint64_t rng = 0x9e3779b97f4a7c15ULL; ///< xorshift state for the compaction offsets
+            mutable std::shared_ptr<const std::vector<std::pair<T, uint64_t>>> cumulative; ///< Sorted (item, cumulative weight), null when stale
+
+            size_t capacity(size_t h) const {
+                const size_t depth = levels.size() - h - 1;
+                return static_cast<size_t>(std::ceil(std::pow(2.0 / 3.0, static_cast<double>(depth)) * static_cast<double>(k))) + 1;
+            }
+
+            void grow() {
+                levels.emplace_back();
+                capacityTotal = 0;
+                for (size_t h = 0; h < levels.size(); ++h) {
+                    capacityTotal += capacity(h);
+                }
+            }
+
+            bool coinFlip() {
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+                return rng & 1;
+            }
+
+            /**
+             * @brief Halves full levels, lowest first, until the sketch fits its capacity.
+             */
+            void compress() {
+                for (size_t h = 0; h < levels.size() && retainedCount >= capacityTotal; ++h) {
+                    if (levels[h].size() < capacity(h)) {
+                        continue;
+                    }
+                    if (h + 1 == levels.size()) {
+                        grow();
+                    }
+                    std::vector<T>& level = levels[h];
+                    std::sort(level.begin(), level.end());
+                    const size_t pairs = level.size() / 2;
+                    const size_t offset = coinFlip() ? 1 : 0;
+                    std::vector<T>& up = levels[h + 1];
+                    for (size_t i = 0; i < pairs; ++i) {
+                        up.push_back(std::move(level[2 * i + offset]));
+                    }
+                    // an odd item out stays at this level
+                    if (level.size() % 2 == 1) {
+                        level[0] = std::move(level.back());
+                        level.resize(1);
+                    } else {
+                        level.clear();
+                    }
+                    retainedCount -= pairs;
+                }
+            }
+
+            /**
+             * @brief Returns the sorted cumulative weights, building them on first use after a write.
+             *
+             * Built into a local and published with atomic_store, so concurrent const queries
+             * never see a half-built table.
+             */
+            std::shared_ptr<const std::vector<std::pair<T, uint64_t>>> sortedWeights() const {
+                auto weights = std::atomic_load(&cumulative);
+                if (!weights) {
+                    auto fresh = std::make_shared<std::vector<std::pair<T, uint64_t>>>();
+                    fresh->reserve(retainedCount);
+                    for (size_t h = 0; h < levels.size(); ++h) {
+                        for (const T& item : levels[h]) {
+                            fresh->emplace_back(item, uint64_t{1} << h);
+                        }
+                    }
+                    std::sort(fresh->begin(), fresh->end(),
+                              [](const auto& a, const auto& b) { return a.first < b.first; });
+                    uint64_t running = 0;
+                    for (auto& entry : *fresh) {
+                        running += entry.second;
+                        entry.second = running;
+                    }
+                    weights = std::move(fresh);
+                    std::atomic_store(&cumulative, weights);
+                }
+                return weights;
+            }
+
+        public:
+            /**
+             * @brief Creates an empty sketch.
+             *
+             * @param accuracy Top-level capacity k (at least 8); the default 200 gives about 1.3% rank error
+             */
+            explicit KllSketch(size_t accuracy = 200) : k(std::max<size_t>(accuracy, 8)) {
+                grow();
+            }
+
+            /**
+             * @brief Creates a sketch whose rank error is about epsilon.
+             *
+             * @param epsilon Target normalized rank error, in (0, 1)
+             * @throws std::invalid_argument If epsilon is not in (0, 1)
+             */
+            static KllSketch with_error(double epsilon) {
+                return KllSketch(accuracy_for_error(epsilon));
+            }
+
+            /**
+             * @brief Returns the smallest k whose normalized_rank_error() is at most about epsilon.
+             *
+             * Inverts error = 2.296 / k^0.9723, e.g. 0.01 gives k = 269 and 0.001 gives k = 2863.
+             *
+             * @throws std::invalid_argument If epsilon is not in (0, 1)
+             */
+            static size_t accuracy_for_error(double epsilon) {
+                if (!(epsilon > 0 && epsilon < 1)) {
+                    throw std::invalid_argument("KllSketch: epsilon must be within (0, 1).");
+                }
+                return static_cast<size_t>(std::ceil(std::pow(2.296 / epsilon, 1.0 / 0.9723)));
+            }
+
+            /**
+             * @brief Adds one item in amortized O(log k).
+             */
+            void update(const T& value) {
+                levels[0].push_back(value);
+                ++retainedCount;
+                ++count;
+                cumulative.reset();
+                if (retainedCount >= capacityTotal) {
+                    compress();
+                }
+            }
+
+            /**
+             * @brief Folds other into this sketch, as if its items had been added here.
+             */
+            void merge(const KllSketch& other) {
+                while (levels.size() < other.levels.size()) {
+                    grow();
+                }
+                for (size_t h = 0; h < other.levels.size(); ++h) {
+                    levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+                    retainedCount += other.levels[h].size();
+                }
+                count += other.count;
+                cumulative.reset();
+                while (retainedCount >= capacityTotal) {
+                    const size_t before = retainedCount;
+                    compress();
+                    if (retainedCount == before) {
+                        break;
+                    }
+                }
+            }
+
+            /**
+             * @brief Returns an item whose rank is approximately q * size().
+             *
+             * @param q Normalized rank in [0, 1]
+             * @throws std::runtime_error If the sketch is empty
+             * @throws std::invalid_argument If q is outside [0, 1]
+             */
+            T quantile(double q) const {
+                if (count == 0) {
+                    throw std::runtime_error("KllSketch: sketch is empty.");
+                }
+                if (!(q >= 0 && q <= 1)) {
+                    throw std::invalid_argument("KllSketch: q must be within [0, 1].");
+                }
+                const auto snapshot = sortedWeights();
+                const auto& weights = *snapshot;
+                const uint64_t total = weights.back().second;
+                const uint64_t target = static_cast<uint64_t>(std::ceil(q * static_cast<double>(total)));
+                auto it = std::lower_bound(weights.begin(), weights.end(), std::max<uint64_t>(target, 1),
+                                           [](const auto& entry, uint64_t w) { return entry.second < w; });
+                return it == weights.end() ? weights.back().first : it->first;
+            }
+
+            /**
+             * @brief Returns the approximate fraction of items strictly less than value.
+             */
+            double rank(const T& value) const {
+                if (count == 0) {
+                    return 0;
+                }
+                const auto snapshot = sortedWeights();
+                const auto& weights = *snapshot;
+                auto it = std::lower_bound(weights.begin(), weights.end(), value,
+                                           [](const auto& entry, const T& v) { return entry.first < v; });
+                const uint64_t below = it == weights.begin() ? 0 : std::prev(it)->second;
+                return static_cast<double>(below) / static_cast<double>(weights.back().second);
+            }
+
+            /**
+             * @brief Returns the number of items the sketch summarizes.
+             */
+            uint64_t size() const {
+                return count;
+            }
+
+            /**
+             * @brief Returns the number of items actually stored.
+             */
+            size_t retained() const {
+                return retainedCount;
+            }
+
+            /**
+             * @brief Returns the expected normalized rank error for this k.
+             */
+            double normalized_rank_error() const {
+                return 2.296 / std::pow(static_cast<double>(k), 0.9723);
+            }
+    };
+
+}
@@ -0,0 +1,236 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include "MyContainer.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <span>
+
+namespace container {
+
+    /**
+     * @brief A MyContainer split into N independently locked shards for multi-core add/remove.
+     *
+     * Values are hash-partitioned, so all copies of a value live in the same shard and
+     * add() and remove() lock only that shard: operations on different shards run in
+     * parallel. Every element is tagged with a global sequence number taken at add() time,
+     * which is how Normal, Reverse and MiddleOut traversals recover insertion order.
+     * Ascending and Descending traversals k-way merge the shards' sorted snapshots.
+     *
+     * Each shard is snapshotted under its own lock, so a traversal that races with
+     * writers sees every shard at some consistent point, not the whole container at one
+     * instant.
+     *
+     * @tparam T The type of elements to store
+     * @tparam N The number of shards
+     */
+    template<typename T = int, size_t N = 16>
+    class ShardedContainer {
+        static_assert(N > 0, "ShardedContainer needs at least one shard");
+
+        private:
+            /**
+             * @brief One partition: a MyContainer plus the sequence number of each element.
+             */
+            struct Shard {
+                mutable std::mutex lock; ///< Guards values and seqs
+                MyContainer<T> values; ///< The shard's elements in insertion order
+                std::vector<uint64_t> seqs; ///< Global sequence number of each element in values
+            };
+
+            std::array<Shard, N> shards; ///< The partitions
+            std::atomic<uint64_t> nextSeq{0}; ///< Source of global sequence numbers
+
+            static size_t shardOf(const T& value) {
+                // spread the bits so identity hashes of small integers still use every shard
+                uint64_t h = static_cast<uint64_t>(std::hash<T>{}(value));
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccdULL;
+                h ^= h >> 33;
+                return static_cast<size_t>(h % N);
+            }
+
+            /**
+             * @brief Copies every shard's (sequence, value) pairs, each under its own lock.
+             */
+            std::array<std::pair<std::vector<uint64_t>, std::vector<T>>, N> snapshotShards() const {
+                std::array<std::pair<std::vector<uint64_t>, std::vector<T>>, N> out;
+                for (size_t s = 0; s < N; ++s) {
+                    const Shard& shard = shards[s];
+                    std::lock_guard<std::mutex> guard(shard.lock);
+                    out[s].first = shard.seqs;
+                    out[s].second = shard.values.getData();
+                }
+                return out;
+            }
+
+            /**
+             * @brief Merges the shards by sequence number into one insertion-ordered vector.
+             */
+            std::vector<T> insertionOrdered() const {
+                auto parts = snapshotShards();
+                using Head = std::pair<uint64_t, size_t>; // (sequence number, shard)
+                std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+                std::array<size_t, N> pos{};
+                size_t total = 0;
+                for (size_t s = 0; s < N; ++s) {
+                    total += parts[s].second.size();
+                    if (!parts[s].first.empty()) {
+                        heads.push({parts[s].first[0], s});
+                    }
+                }
+                std::vector<T> merged;
+                merged.reserve(total);
+                while (!heads.empty()) {
+                    size_t s = heads.top().second;
+                    heads.pop();
+                    merged.push_back(std::move(parts[s].second[pos[s]]));
+                    if (++pos[s] < parts[s].first.size()) {
+                        heads.push({parts[s].first[pos[s]], s});
+                    }
+                }
+                return merged;
+            }
+
+            /**
+             * @brief K-way merges the shards' sorted snapshots ascending.
+             *
+             * Each shard's snapshot is taken under its lock through ascending_view(), which is
+             * O(1) while the shard has not been written since its last sort (a stale shard is
+             * sorted once and keeps the result cached). The merge then reads the shared
+             * snapshots outside the locks.
+             */
+            std::vector<T> ascendingMerged() const {
+                std::array<SortedRange<T>, N> sorted;
+                std::vector<std::span<const T>> runs;
+                size_t total = 0;
+                for (size_t s = 0; s < N; ++s) {
+                    const Shard& shard = shards[s];
+                    {
+                        std::lock_guard<std::mutex> guard(shard.lock);
+                        sorted[s] = shard.values.ascending_view();
+                    }
+                    if (!sorted[s].empty()) {
+                        runs.push_back(sorted[s].as_span());
+                        total += sorted[s].size();
+                    }
+                }
+                std::vector<T> merged;
+                merged.reserve(total);
+                detail::merge_runs(runs, merged);
+                return merged;
+            }
+
+        public:
+            ShardedContainer() = default;
+
+            ShardedContainer(const ShardedContainer&) = delete;
+            ShardedContainer& operator=(const ShardedContainer&) = delete;
+
+            /**
+             * @brief Adds an element, locking only the shard it hashes to.
+             *
+             * @param value The value to add
+             */
+            void add(const T& value) {
+                Shard& shard = shards[shardOf(value)];
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.seqs.push_back(nextSeq.fetch_add(1, std::memory_order_relaxed));
+                shard.values.add(value);
+            }
+
+            /**
+             * @brief Removes all occurrences of a value, scanning and locking only its shard.
+             *
+             * @param value The value to remove
+             * @throws std::runtime_error If the element is not found in the container
+             */
+            void remove(const T& value) {
+                Shard& shard = shards[shardOf(value)];
+                std::lock_guard<std::mutex> guard(shard.lock);
+                const std::vector<T>& data = shard.values.getData();
+                size_t kept = 0;
+                for (size_t i = 0; i < data.size(); ++i) {
+                    if (!(data[i] == value)) {
+                        shard.seqs[kept++] = shard.seqs[i];
+                    }
+                }
+                shard.values.remove(value); // throws before seqs is shrunk if nothing matched
+                shard.seqs.resize(kept);
+            }
+
+            /**
+             * @brief Returns the total number of elements across all shards.
+             */
+            size_t size() const {
+                size_t total = 0;
+                for (const Shard& s : shards) {
+                    std::lock_guard<std::mutex> guard(s.lock);
+                    total += s.values.size();
+                }
+                return total;
+            }
+
+            /**
+             * @brief Returns the number of elements in one shard (for balance diagnostics).
+             */
+            size_t shard_size(size_t shard) const {
+                const Shard& s = shards.at(shard);
+                std::lock_guard<std::mutex> guard(s.lock);
+                return s.values.size();
+            }
+
+            /**
+             * @brief Returns the elements in the given order as a new vector.
+             *
+             * Normal and Reverse merge the shards by sequence number; sorted orders merge
+             * the shards' sorted snapshots; MiddleOut and SideCross are then applied to the
+             * merged sequence.
+             *
+             * @param order The traversal order
+             * @return std::vector<T> The materialized sequence
+             */
+            std::vector<T> to_vector(Order order) const {
+                std::vector<T> merged;
+                switch (order) {
+                    case Order::Normal:
+                        return insertionOrdered();
+                    case Order::Reverse:
+                        merged = insertionOrdered();
+                        std::reverse(merged.begin(), merged.end());
+                        return merged;
+                    case Order::Ascending:
+                        return ascendingMerged();
+                    case Order::Descending:
+                        merged = ascendingMerged();
+                        std::reverse(merged.begin(), merged.end());
+                        return merged;
+                    default:
+                        break;
+                }
+                std::vector<T> base = order == Order::SideCross ? ascendingMerged() : insertionOrdered();
+                merged.reserve(base.size());
+                auto push = [&merged](const T& value) { merged.push_back(value); };
+                if (order == Order::SideCross) {
+                    detail::visit_range<Order::SideCross>(base.data(), base.size(), push);
+                } else {
+                    detail::visit_range<Order::MiddleOut>(base.data(), base.size(), push);
+                }
+                return merged;
+            }
+
+            /**
+             * @brief Calls fn on every element in the order chosen at compile time.
+             */
+            template<Order O, typename Fn>
+            void visit(Fn&& fn) const {
+                std::vector<T> base = (O == Order::Ascending || O == Order::Descending || O == Order::SideCross)
+                    ? ascendingMerged() : insertionOrdered();
+                detail::visit_range<O>(base.data(), base.size(), fn);
+            }
+    };
+
+}
@@ -0,0 +1,441 @@
+//noa.honigstein@gmail.com
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONTAINER_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define CONTAINER_SIMD_X86 0
+#endif
+
+namespace container::simd {
+
+    /**
+     * @brief True for the element types that have explicit SIMD scan kernels.
+     */
+    template<typename T>
+    inline constexpr bool has_kernels = std::is_same_v<T, int> || std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+    /**
+     * @brief True for the element types the interleaving copy kernels handle (any trivially
+     * copyable 4- or 8-byte type; the kernels only move bytes).
+     */
+    template<typename T>
+    inline constexpr bool has_zip_kernels = std::is_trivially_copyable_v<T> && (sizeof(T) == 4 || sizeof(T) == 8);
+
+    /**
+     * @brief Interleaving copy of count forward and count backward elements of Size bytes each.
+     *
+     * Writes fwd[0], back[0], fwd[1], back[-1], ... to out, where back points at the last
+     * element of the backward run.
+     */
+    using ZipReversed = void (*)(const char* fwd, const char* back, size_t count, char* out);
+
+    /**
+     * @brief Equality scan kernels for one element type and instruction set.
+     */
+    template<typename T>
+    struct ScanKernels {
+        size_t (*find)(const T* p, size_t n, T value); ///< Index of the first match, or n
+        size_t (*count)(const T* p, size_t n, T value); ///< Number of matches
+        const char* isa; ///< Instruction set the kernels use ("avx2", "sse2" or "scalar")
+    };
+
+    namespace kernels {
+        template<typename T>
+        size_t findScalar(const T* p, size_t n, T value) {
+            for (size_t i = 0; i < n; ++i) {
+                if (p[i] == value) {
+                    return i;
+                }
+            }
+            return n;
+        }
+
+        template<typename T>
+        size_t countScalar(const T* p, size_t n, T value) {
+            size_t found = 0;
+            for (size_t i = 0; i < n; ++i) {
+                found += p[i] == value;
+            }
+            return found;
+        }
+
+#if CONTAINER_SIMD_X86
+        // Each kernel compares one vector against the broadcast value, turns the lane
+        // results into a bit mask with movemask, and either stops at the first set bit
+        // (find) or adds its popcount (count). The scalar loop handles the tail.
+
+        inline int maskSse2(const int* p, __m128i needle) {
+            __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), needle);
+            return _mm_movemask_ps(_mm_castsi128_ps(eq));
+        }
+
+        inline int maskSse2(const float* p, __m128 needle) {
+            return _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(p), needle));
+        }
+
+        inline int maskSse2(const double* p, __m128d needle) {
+            return _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p), needle));
+        }
+
+        inline __m128i splatSse2(int v) {
+            return _mm_set1_epi32(v);
+        }
+
+        inline __m128 splatSse2(float v) {
+            return _mm_set1_ps(v);
+        }
+
+        inline __m128d splatSse2(double v) {
+            return _mm_set1_pd(v);
+        }
+
+        template<typename T>
+        size_t findSse2(const T* p, size_t n, T value) {
+            constexpr size_t width = 16 / sizeof(T);
+            const auto needle = splatSse2(value);
+            size_t i = 0;
+            for (; i + width <= n; i += width) {
+                if (int mask = maskSse2(p + i, needle)) {
+                    return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                }
+            }
+            return i + findScalar(p + i, n - i, value);
+        }
+
+        template<typename T>
+        size_t countSse2(const T* p, size_t n, T value) {
+            constexpr size_t width = 16 / sizeof(T);
+            const auto needle = splatSse2(value);
+            size_t found = 0;
+            size_t i = 0;
+            for (; i + width <= n; i += width) {
+                found += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(maskSse2(p + i, needle))));
+            }
+            return found + countScalar(p + i, n - i, value);
+        }
+
+        __attribute__((target("avx2"))) inline size_t findAvx2(const int* p, size_t n, int value) {
+            const __m256i needle = _mm256_set1_epi32(value);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), needle);
+                if (int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq))) {
+                    return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                }
+            }
+            return i + findScalar(p + i, n - i, value);
+        }
+
+        __attribute__((target("avx2"))) inline size_t findAvx2(const float* p, size_t n, float value) {
+            const __m256 needle = _mm256_set1_ps(value);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                if (int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p + i), needle, _CMP_EQ_OQ))) {
+                    return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                }
+            }
+            return i + findScalar(p + i, n - i, value);
+        }
+
+        __attribute__((target("avx2"))) inline size_t findAvx2(const double* p, size_t n, double value) {
+            const __m256d needle = _mm256_set1_pd(value);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                if (int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), needle, _CMP_EQ_OQ))) {
+                    return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                }
+            }
+            return i + findScalar(p + i, n - i, value);
+        }
+
+        __attribute__((target("avx2"))) inline size_t countAvx2(const int* p, size_t n, int value) {
+            const __m256i needle = _mm256_set1_epi32(value);
+            size_t found = 0;
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), needle);
+                found += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(eq)))));
+            }
+            return found + countScalar(p + i, n - i, value);
+        }
+
+        __attribute__((target("avx2"))) inline size_t countAvx2(const float* p, size_t n, float value) {
+            const __m256 needle = _mm256_set1_ps(value);
+            size_t found = 0;
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(p + i), needle, _CMP_EQ_OQ));
+                found += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+            }
+            return found + countScalar(p + i, n - i, value);
+        }
+
+        __attribute__((target("avx2"))) inline size_t countAvx2(const double* p, size_t n, double value) {
+            const __m256d needle = _mm256_set1_pd(value);
+            size_t found = 0;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), needle, _CMP_EQ_OQ));
+                found += static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(mask)));
+            }
+            return found + countScalar(p + i, n - i, value);
+        }
+#endif
+
+        inline size_t countLess8Scalar(const int* p, int value) {
+            size_t below = 0;
+            for (size_t i = 0; i < 8; ++i) {
+                below += p[i] < value;
+            }
+            return below;
+        }
+
+        template<size_t Size>
+        void zipReversedScalar(const char* fwd, const char* back, size_t count, char* out) {
+            for (size_t j = 0; j < count; ++j) {
+                std::memcpy(out + 2 * j * Size, fwd + j * Size, Size);
+                std::memcpy(out + (2 * j + 1) * Size, back - j * Size, Size);
+            }
+        }
+
+#if CONTAINER_SIMD_X86
+        // The zip kernels load a block of the forward run and the mirrored block of the
+        // backward run, reverse the latter with a shuffle and interleave the two with
+        // unpacklo/unpackhi (plus a cross-lane permute for AVX2). The scalar loop handles the tail.
+
+        inline void zipReversed4Sse2(const char* fwd, const char* back, size_t count, char* out) {
+            size_t j = 0;
+            for (; j + 4 <= count; j += 4) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fwd + j * 4));
+                __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(back - (j + 3) * 4)), 0x1B);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * 8), _mm_unpacklo_epi32(a, b));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * 8 + 16), _mm_unpackhi_epi32(a, b));
+            }
+            zipReversedScalar<4>(fwd + j * 4, back - j * 4, count - j, out + j * 8);
+        }
+
+        inline void zipReversed8Sse2(const char* fwd, const char* back, size_t count, char* out) {
+            size_t j = 0;
+            for (; j + 2 <= count; j += 2) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fwd + j * 8));
+                __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(back - (j + 1) * 8)), 0x4E);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * 16), _mm_unpacklo_epi64(a, b));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * 16 + 16), _mm_unpackhi_epi64(a, b));
+            }
+            zipReversedScalar<8>(fwd + j * 8, back - j * 8, count - j, out + j * 16);
+        }
+
+        __attribute__((target("avx2"))) inline void zipReversed4Avx2(const char* fwd, const char* back, size_t count, char* out) {
+            const __m256i reversed = _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            size_t j = 0;
+            for (; j + 8 <= count; j += 8) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fwd + j * 4));
+                __m256i b = _mm256_permutevar8x32_epi32(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(back - (j + 7) * 4)), reversed);
+                __m256i lo = _mm256_unpacklo_epi32(a, b);
+                __m256i hi = _mm256_unpackhi_epi32(a, b);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * 8), _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * 8 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+            zipReversed4Sse2(fwd + j * 4, back - j * 4, count - j, out + j * 8);
+        }
+
+        __attribute__((target("avx2"))) inline void zipReversed8Avx2(const char* fwd, const char* back, size_t count, char* out) {
+            size_t j = 0;
+            for (; j + 4 <= count; j += 4) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fwd + j * 8));
+                __m256i b = _mm256_permute4x64_epi64(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(back - (j + 3) * 8)), 0x1B);
+                __m256i lo = _mm256_unpacklo_epi64(a, b);
+                __m256i hi = _mm256_unpackhi_epi64(a, b);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * 16), _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j * 16 + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+            zipReversed8Sse2(fwd + j * 8, back - j * 8, count - j, out + j * 16);
+        }
+
+        inline size_t countLess8Sse2(const int* p, int value) {
+            const __m128i needle = _mm_set1_epi32(value);
+            __m128i lo = _mm_cmpgt_epi32(needle, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            __m128i hi = _mm_cmpgt_epi32(needle, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 4)));
+            return static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(lo))))
+                                       + __builtin_popcount(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(hi)))));
+        }
+
+        __attribute__((target("avx2"))) inline size_t countLess8Avx2(const int* p, int value) {
+            __m256i less = _mm256_cmpgt_epi32(_mm256_set1_epi32(value), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+            return static_cast<size_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(less)))));
+        }
+#endif
+    }
+
+    /**
+     * @brief Returns the best "how many of these 8 sorted ints are below value" kernel.
+     *
+     * On an ascending block the lanes below value form a prefix, so the count is the
+     * position of value's lower bound inside the block.
+     */
+    using CountLess8 = size_t (*)(const int* p, int value);
+
+    inline CountLess8 count_less8() {
+        static const CountLess8 chosen = []() -> CountLess8 {
+#if CONTAINER_SIMD_X86
+            return __builtin_cpu_supports("avx2") ? kernels::countLess8Avx2 : kernels::countLess8Sse2;
+#else
+            return kernels::countLess8Scalar;
+#endif
+        }();
+        return chosen;
+    }
+
+    /**
+     * @brief Multiset intersection of two ascending int arrays, galloping through the larger one.
+     *
+     * For each run of equal values in small, the lower bound in large is found by
+     * exponential search from the previous position, a binary search down to an
+     * 8-element window, and one SIMD compare of that window. Each value is emitted
+     * min(count in small, count in large) times, as std::set_intersection does.
+     * Costs O(|small| log(|large| / |small|)), which beats a linear merge when the sizes
+     * are very different.
+     *
+     * @param out Receives the result; needs room for min(ns, nl) values
+     * @return size_t Number of values written
+     */
+    inline size_t gallop_intersect(const int* small, size_t ns, const int* large, size_t nl, int* out) {
+        const auto countLess = count_less8();
+        size_t written = 0;
+        size_t pos = 0;
+        for (size_t i = 0; i < ns && pos < nl; ) {
+            const int value = small[i];
+            size_t run = 1;
+            while (i + run < ns && small[i + run] == value) {
+                ++run;
+            }
+            i += run;
+            size_t lo = pos;
+            size_t bound = 8;
+            while (lo + bound <= nl && large[lo + bound - 1] < value) {
+                lo += bound;
+                bound *= 2;
+            }
+            size_t hi = lo + bound < nl ? lo + bound : nl;
+            while (hi - lo > 8) {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (large[mid] < value) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo + 8 <= nl) {
+                lo += countLess(large + lo, value);
+            } else {
+                while (lo < hi && large[lo] < value) {
+                    ++lo;
+                }
+            }
+            pos = lo;
+            size_t matches = 0;
+            while (pos < nl && large[pos] == value) {
+                ++pos;
+                ++matches;
+            }
+            for (size_t k = 0; k < run && k < matches; ++k) {
+                out[written++] = value;
+            }
+        }
+        return written;
+    }
+
+    /**
+     * @brief Returns the best interleaving copy kernel for Size-byte elements (4 or 8).
+     */
+    template<size_t Size>
+    ZipReversed zip_reversed_kernel() {
+        static_assert(Size == 4 || Size == 8, "no zip kernels for this element size");
+        static const ZipReversed chosen = []() -> ZipReversed {
+#if CONTAINER_SIMD_X86
+            if constexpr (Size == 4) {
+                return __builtin_cpu_supports("avx2") ? kernels::zipReversed4Avx2 : kernels::zipReversed4Sse2;
+            } else {
+                return __builtin_cpu_supports("avx2") ? kernels::zipReversed8Avx2 : kernels::zipReversed8Sse2;
+            }
+#else
+            return kernels::zipReversedScalar<Size>;
+#endif
+        }();
+        return chosen;
+    }
+
+    /**
+     * @brief Writes fwd[0], back[0], fwd[1], back[-1], ... (2 * count elements) to out.
+     *
+     * This is the shape of the side-cross and middle-out orders over a sorted or stored
+     * buffer: one run read forward, the other backward. out must not overlap the input.
+     *
+     * @param back Last element of the backward run; both runs need count elements
+     */
+    template<typename T>
+    void zip_reversed(const T* fwd, const T* back, size_t count, T* out) {
+        static_assert(has_zip_kernels<T>, "no zip kernels for this type");
+        if (count == 0) {
+            return;
+        }
+        zip_reversed_kernel<sizeof(T)>()(reinterpret_cast<const char*>(fwd), reinterpret_cast<const char*>(back),
+                                         count, reinterpret_cast<char*>(out));
+    }
+
+    /**
+     * @brief Returns the best equality scan kernels for T on the running CPU.
+     *
+     * The choice is made once, on first use, from __builtin_cpu_supports: AVX2 when
+     * available, otherwise SSE2 (always present on x86-64), and plain loops on other
+     * architectures.
+     */
+    template<typename T>
+    const ScanKernels<T>& scan_kernels() {
+        static_assert(has_kernels<T>, "no SIMD scan kernels for this type");
+        static const ScanKernels<T> chosen = []() {
+#if CONTAINER_SIMD_X86
+            if (__builtin_cpu_supports("avx2")) {
+                return ScanKernels<T>{
+                    static_cast<size_t (*)(const T*, size_t, T)>(kernels::findAvx2),
+                    static_cast<size_t (*)(const T*, size_t, T)>(kernels::countAvx2), "avx2"};
+            }
+            return ScanKernels<T>{kernels::findSse2<T>, kernels::countSse2<T>, "sse2"};
+#else
+            return ScanKernels<T>{kernels::findScalar<T>, kernels::countScalar<T>, "scalar"};
+#endif
+        }();
+        return chosen;
+    }
+
+    /**
+     * @brief Removes every element equal to value from [p, p + n) in place, keeping order.
+     *
+     * The find kernel locates each match; the runs between matches are moved down with
+     * memmove, so long match-free stretches are never touched element by element.
+     *
+     * @return size_t Number of elements kept (the new logical size)
+     */
+    template<typename T>
+    size_t remove_equal(T* p, size_t n, T value) {
+        const auto find = scan_kernels<T>().find;
+        size_t out = find(p, n, value);
+        size_t in = out;
+        while (in < n) {
+            ++in; // skip the match
+            const size_t next = in + find(p + in, n - in, value);
+            std::memmove(p + out, p + in, (next - in) * sizeof(T));
+            out += next - in;
+            in = next;
+        }
+        return out;
+    }
+
+}
@@ -3,8 +3,16 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 #include "../include/MyContainer.hpp"
+#include "../include/ConcurrentContainer.hpp"
+#include "../include/IngestBuffer.hpp"
+#include "../include/ShardedContainer.hpp"
 #include <string>
 #include <sstream>
+#include <locale>
+#include <thread>
+#include <atomic>
+#include <numeric>
+#include <cstdint>
 using namespace container;
 
 TEST_CASE("MyContainer with int") {
@@ -102,7 +110,7 @@ TEST_CASE("AscendingIterator: dereferencing end throws") {
     MyContainer<int> c;
     c.add(1);
     auto it = c.end_ascending_order();
-    CHECK_THROWS_WITH(*it, "Attempted to desourceerence AscendingIterator beyond the end.");
+    CHECK_THROWS_WITH(*it, "Attempted to dereference AscendingIterator beyond the end.");
 }
 
 TEST_CASE("AscendingIterator: incrementing past end throws") {
@@ -171,7 +179,7 @@ TEST_CASE("DescendingIterator: dereferencing end throws") {
     MyContainer<int> c;
     c.add(1);
     auto it = c.end_descending_order();
-    CHECK_THROWS_WITH(*it, "Attempted to desourceerence - DescendingIterator beyond the end.");
+    CHECK_THROWS_WITH(*it, "Attempted to dereference - DescendingIterator beyond the end.");
 }
 
 TEST_CASE("DescendingIterator: incrementing past end throws") {
@@ -247,7 +255,7 @@ TEST_CASE("SideCrossIterator: dereferencing end throws") {
     MyContainer<int> c;
     c.add(1);
     auto it = c.end_side_cross_order();
-    CHECK_THROWS_WITH(*it, "Cannot desourceerence SideCrossIterator: out of range");
+    CHECK_THROWS_WITH(*it, "Cannot dereference SideCrossIterator: out of range");
 }
 
 TEST_CASE("SideCrossIterator: incrementing past end throws") {
@@ -263,7 +271,7 @@ TEST_CASE("ReverseIterator: empty container") {
     auto it = c.begin_reverse_order();
     auto end = c.end_reverse_order();
     CHECK(it == end); // nothing to iterate
-    CHECK_THROWS_WITH(*it, "Cannot desourceerence ReverseIterator: out of range");
+    CHECK_THROWS_WITH(*it, "Cannot dereference ReverseIterator: out of range");
 
     std::ostringstream oss;
     for (auto it = c.begin_reverse_order(); it != c.end_reverse_order(); ++it) {
@@ -303,10 +311,10 @@ TEST_CASE("ReverseIterator: dereferencing end throws") {
     c.add(5);
     auto it = c.begin_reverse_order();
     ++it;
-    CHECK_THROWS_WITH(*it, "Cannot desourceerence ReverseIterator: out of range");
+    CHECK_THROWS_WITH(*it, "Cannot dereference ReverseIterator: out of range");
 
     auto end = c.end_reverse_order();
-    CHECK_THROWS_WITH(*end, "Cannot desourceerence ReverseIterator: out of range");
+    CHECK_THROWS_WITH(*end, "Cannot dereference ReverseIterator: out of range");
 
 }
 
@@ -324,7 +332,7 @@ TEST_CASE("OrderIterator: empty container") {
     auto it = c.begin_order();
     auto end = c.end_order();
     CHECK(it == end); // should not iterate
-    CHECK_THROWS_WITH(*it, "Cannot desourceerence OrderIterator: out of range");
+    CHECK_THROWS_WITH(*it, "Cannot dereference OrderIterator: out of range");
 
     std::ostringstream oss;
     for (auto it = c.begin_order(); it != c.end_order(); ++it) {
@@ -362,7 +370,7 @@ TEST_CASE("OrderIterator: dereferencing end throws") {
     MyContainer<int> c;
     c.add(77);
     auto it = c.end_order();
-    CHECK_THROWS_WITH(*it, "Cannot desourceerence OrderIterator: out of range");
+    CHECK_THROWS_WITH(*it, "Cannot dereference OrderIterator: out of range");
 }
 
 TEST_CASE("OrderIterator: incrementing past end throws") {
@@ -448,3 +456,1558 @@ TEST_CASE("MiddleOutIterator: incrementing past end throws") {
 
 
 
+
+TEST_CASE("visit: every order matches its iterator") {
+    for (int n = 0; n <= 6; ++n) {
+        MyContainer<int> c;
+        for (int i = 0; i < n; ++i) {
+            c.add((i * 7) % 5 + i);
+        }
+
+        std::vector<int> expected, actual;
+        auto collect = [&actual](const int& v) { actual.push_back(v); };
+
+        for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) expected.push_back(*it);
+        c.visit<Order::Ascending>(collect);
+        CHECK(actual == expected);
+
+        expected.clear(); actual.clear();
+        for (auto it = c.begin_descending_order(); it != c.end_descending_order(); ++it) expected.push_back(*it);
+        c.visit<Order::Descending>(collect);
+        CHECK(actual == expected);
+
+        expected.clear(); actual.clear();
+        for (auto it = c.begin_side_cross_order(); it != c.end_side_cross_order(); ++it) expected.push_back(*it);
+        c.visit<Order::SideCross>(collect);
+        CHECK(actual == expected);
+
+        expected.clear(); actual.clear();
+        for (auto it = c.begin_reverse_order(); it != c.end_reverse_order(); ++it) expected.push_back(*it);
+        c.visit<Order::Reverse>(collect);
+        CHECK(actual == expected);
+
+        expected.clear(); actual.clear();
+        for (auto it = c.begin_order(); it != c.end_order(); ++it) expected.push_back(*it);
+        c.visit<Order::Normal>(collect);
+        CHECK(actual == expected);
+
+        expected.clear(); actual.clear();
+        for (auto it = c.begin_middle_out_order(); it != c.end_middle_out_order(); ++it) expected.push_back(*it);
+        c.visit<Order::MiddleOut>(collect);
+        CHECK(actual == expected);
+    }
+}
+
+TEST_CASE("visit: works with strings and stateful visitors") {
+    MyContainer<std::string> c;
+    c.add("zebra");
+    c.add("apple");
+    c.add("dog");
+
+    std::string joined;
+    c.visit<Order::SideCross>([&joined](const std::string& s) { joined += s + " "; });
+    CHECK(joined == "apple zebra dog ");
+
+    size_t total = 0;
+    c.visit<Order::Normal>([&total](const std::string& s) { total += s.size(); });
+    CHECK(total == 13);
+}
+
+TEST_CASE("AnyOrderRange: runtime order matches compile-time visit") {
+    MyContainer<int> c;
+    for (int i = 0; i < 1000; ++i) {
+        c.add((i * 37) % 101);
+    }
+    const Order orders[] = {Order::Ascending, Order::Descending, Order::SideCross,
+                            Order::Reverse, Order::Normal, Order::MiddleOut};
+    std::vector<std::vector<int>> expected(6);
+    c.visit<Order::Ascending>([&](int v) { expected[0].push_back(v); });
+    c.visit<Order::Descending>([&](int v) { expected[1].push_back(v); });
+    c.visit<Order::SideCross>([&](int v) { expected[2].push_back(v); });
+    c.visit<Order::Reverse>([&](int v) { expected[3].push_back(v); });
+    c.visit<Order::Normal>([&](int v) { expected[4].push_back(v); });
+    c.visit<Order::MiddleOut>([&](int v) { expected[5].push_back(v); });
+
+    for (size_t k = 0; k < 6; ++k) {
+        auto range = c.any_order(orders[k]);
+        CHECK(range.order() == orders[k]);
+        CHECK(range.size() == 1000);
+        std::vector<int> actual;
+        range.for_each([&actual](int v) { actual.push_back(v); });
+        CHECK(actual == expected[k]);
+    }
+}
+
+TEST_CASE("AnyOrderRange: batches and copies") {
+    MyContainer<int> c;
+    c.add(5);
+    c.add(1);
+    c.add(9);
+
+    auto range = c.any_order(order_from_string("side_cross"));
+    auto copy = range; // owns its own sorted copy
+    const int* out[2];
+    CHECK(copy.next_batch(0, out, 2) == 2);
+    CHECK(*out[0] == 1);
+    CHECK(*out[1] == 9);
+    CHECK(copy.next_batch(2, out, 2) == 1);
+    CHECK(*out[0] == 5);
+    CHECK(copy.next_batch(3, out, 2) == 0);
+
+    size_t batches = 0;
+    c.any_order(Order::Normal).for_each_batch([&batches](const int* const*, size_t n) {
+        CHECK(n == 3);
+        ++batches;
+    });
+    CHECK(batches == 1);
+
+    MyContainer<int> empty;
+    empty.any_order(Order::MiddleOut).for_each([](int) { CHECK(false); });
+    CHECK_THROWS_AS(order_from_string("sideways"), std::invalid_argument);
+}
+
+// User-defined generator used by the tests: bit-reversal order for power-of-two sizes.
+struct BitReversalOrder {
+    static size_t index(size_t pos, size_t n) {
+        size_t bits = 0;
+        while ((size_t(1) << bits) < n) ++bits;
+        size_t r = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            r |= ((pos >> b) & 1) << (bits - 1 - b);
+        }
+        return r;
+    }
+};
+
+TEST_CASE("GeneratedRange: user-defined bit-reversal order") {
+    MyContainer<int> c;
+    for (int i = 0; i < 8; ++i) {
+        c.add(i * 10);
+    }
+    std::vector<int> expected = {0, 40, 20, 60, 10, 50, 30, 70};
+    std::vector<int> actual;
+    for (const int& v : c.generated<BitReversalOrder>()) {
+        actual.push_back(v);
+    }
+    CHECK(actual == expected);
+}
+
+TEST_CASE("GeneratedRange: StrideOrder and ZigZagOrder") {
+    MyContainer<int> c;
+    for (int i = 0; i < 7; ++i) {
+        c.add(i);
+    }
+    std::vector<int> actual;
+    c.generated<StrideOrder<3>>().for_each([&actual](int v) { actual.push_back(v); });
+    CHECK(actual == std::vector<int>{0, 3, 6, 1, 4, 2, 5});
+
+    MyContainer<int> unsorted;
+    for (int v : {9, 2, 7, 4, 1, 8, 3}) {
+        unsorted.add(v);
+    }
+    actual.clear();
+    auto zig = unsorted.generated<ZigZagOrder<3>>();
+    auto copy = zig; // owns its own sorted copy
+    const int* out[16];
+    size_t got = copy.next_batch(0, out, 16);
+    for (size_t i = 0; i < got; ++i) {
+        actual.push_back(*out[i]);
+    }
+    CHECK(actual == std::vector<int>{1, 2, 3, 8, 7, 4, 9});
+    CHECK_THROWS_WITH(*zig.end(), "Cannot dereference GeneratedRange iterator: out of range");
+}
+
+TEST_CASE("GeneratedRange: parallel split visits every element once") {
+    MyContainer<int> c;
+    for (int i = 0; i < 10001; ++i) {
+        c.add(i);
+    }
+    std::vector<int> seen(c.size(), 0);
+    c.generated<StrideOrder<4>>().parallel_for_each([&seen](const int& v) { ++seen[v]; }, 4);
+    CHECK(std::count(seen.begin(), seen.end(), 1) == 10001);
+
+    MyContainer<int> empty;
+    empty.generated<StrideOrder<4>>().parallel_for_each([](int) { CHECK(false); }, 4);
+}
+
+TEST_CASE("copy_to / to_vector: every order matches its iterator") {
+    for (int n = 0; n <= 9; ++n) {
+        MyContainer<int> c;
+        for (int i = 0; i < n; ++i) {
+            c.add((i * 5) % 7 - i);
+        }
+        const Order orders[] = {Order::Ascending, Order::Descending, Order::SideCross,
+                                Order::Reverse, Order::Normal, Order::MiddleOut};
+        for (Order order : orders) {
+            std::vector<int> expected;
+            c.any_order(order).for_each([&expected](int v) { expected.push_back(v); });
+
+            CHECK(c.to_vector(order) == expected);
+
+            std::vector<int> buffer(n, -1);
+            int* end = c.copy_to(order, buffer.data());
+            CHECK(end == buffer.data() + n);
+            CHECK(buffer == expected);
+
+            std::vector<int> pushed;
+            c.copy_to(order, std::back_inserter(pushed));
+            CHECK(pushed == expected);
+        }
+    }
+}
+
+TEST_CASE("copy_to: side-cross and middle-out SIMD interleaving matches the iterators") {
+    auto check = [](auto sample) {
+        using V = decltype(sample);
+        for (int n = 0; n <= 70; ++n) {
+            MyContainer<V> c;
+            for (int i = 0; i < n; ++i) {
+                c.add(static_cast<V>((i * 37) % 23 - i));
+            }
+            for (Order order : {Order::SideCross, Order::MiddleOut}) {
+                std::vector<V> expected;
+                c.any_order(order).for_each([&expected](const V& v) { expected.push_back(v); });
+                std::vector<V> buffer(n);
+                c.copy_to(order, buffer.data());
+                CHECK(buffer == expected);
+            }
+        }
+    };
+    check(int{});
+    check(float{});
+    check(double{});
+    check(static_cast<long long>(0));
+    check(static_cast<short>(0)); // no kernel for 2-byte elements; plain loop
+
+#if CONTAINER_SIMD_X86
+    std::vector<int> raw(21);
+    std::iota(raw.begin(), raw.end(), 0);
+    std::vector<int> zipped(20);
+    simd::kernels::zipReversed4Sse2(reinterpret_cast<const char*>(raw.data()),
+                                    reinterpret_cast<const char*>(raw.data() + 20), 10,
+                                    reinterpret_cast<char*>(zipped.data()));
+    CHECK(zipped[0] == 0);
+    CHECK(zipped[1] == 20);
+    CHECK(zipped[18] == 9);
+    CHECK(zipped[19] == 11);
+#endif
+}
+
+TEST_CASE("copy_to / to_vector: non-trivial element type") {
+    MyContainer<std::string> c;
+    c.add("zebra");
+    c.add("apple");
+    c.add("dog");
+    c.add("cat");
+    CHECK(c.to_vector(Order::MiddleOut) == std::vector<std::string>{"dog", "apple", "cat", "zebra"});
+    CHECK(c.to_vector(Order::SideCross) == std::vector<std::string>{"apple", "zebra", "cat", "dog"});
+
+    std::vector<std::string> out(4);
+    c.copy_to(Order::Reverse, out.begin());
+    CHECK(out == std::vector<std::string>{"cat", "dog", "apple", "zebra"});
+}
+
+TEST_CASE("as_span / as_reverse_span: zero-copy views") {
+    MyContainer<double> c;
+    c.add(1.5);
+    c.add(2.5);
+    c.add(3.5);
+
+    std::span<const double> s = c.as_span();
+    CHECK(s.size() == 3);
+    CHECK(s.data() == c.getData().data());
+    CHECK(s[0] == 1.5);
+    CHECK(s[2] == 3.5);
+
+    ReverseSpan<double> r = c.as_reverse_span();
+    CHECK(r.size() == 3);
+    CHECK(r[0] == 3.5);
+    CHECK(r[2] == 1.5);
+    CHECK(r.base().data() == s.data());
+    std::vector<double> reversed(r.begin(), r.end());
+    CHECK(reversed == std::vector<double>{3.5, 2.5, 1.5});
+
+    MyContainer<double> empty;
+    CHECK(empty.as_span().empty());
+    CHECK(empty.as_reverse_span().begin() == empty.as_reverse_span().end());
+}
+
+TEST_CASE("ConcurrentContainer: snapshots are isolated from later writes") {
+    ConcurrentContainer<int> c;
+    for (int i = 0; i < 5000; ++i) {
+        c.add(i % 10);
+    }
+    auto before = c.snapshot();
+    c.add(42);
+    c.remove(3);
+    CHECK(before.size() == 5000);
+    CHECK(before[3] == 3);
+    CHECK(c.size() == 4501);
+    CHECK_THROWS_WITH(c.remove(77), "Element not found in container.");
+    CHECK_THROWS_AS(before[5000], std::out_of_range);
+
+    auto after = c.snapshot();
+    std::vector<int> normal;
+    after.visit<Order::Normal>([&normal](int v) { normal.push_back(v); });
+    CHECK(normal.size() == 4501);
+    CHECK(normal.back() == 42);
+    CHECK(std::count(normal.begin(), normal.end(), 3) == 0);
+
+    std::vector<int> reverse;
+    after.visit<Order::Reverse>([&reverse](int v) { reverse.push_back(v); });
+    CHECK(std::equal(reverse.rbegin(), reverse.rend(), normal.begin()));
+
+    std::vector<int> ascending;
+    after.visit<Order::Ascending>([&ascending](int v) { ascending.push_back(v); });
+    CHECK(std::is_sorted(ascending.begin(), ascending.end()));
+    CHECK(ascending.back() == 42);
+}
+
+TEST_CASE("ConcurrentContainer: readers never see a torn state while writers append") {
+    ConcurrentContainer<int> c;
+    std::atomic<bool> done{false};
+    std::atomic<int> badSnapshots{0};
+
+    std::thread writer([&]() {
+        for (int i = 0; i < 20000; ++i) {
+            c.add(i);
+        }
+        done = true;
+    });
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                auto snap = c.snapshot();
+                int expected = 0;
+                snap.visit<Order::Normal>([&](int v) {
+                    if (v != expected++) {
+                        ++badSnapshots;
+                    }
+                });
+                if (static_cast<size_t>(expected) != snap.size()) {
+                    ++badSnapshots;
+                }
+            }
+        });
+    }
+    writer.join();
+    for (auto& t : readers) {
+        t.join();
+    }
+    CHECK(badSnapshots == 0);
+    CHECK(c.size() == 20000);
+}
+
+TEST_CASE("IngestBuffer: concurrent producers publish every element in batches") {
+    IngestBuffer<int> buffer;
+    MyContainer<int> target;
+    const int producers = 4;
+    const int perProducer = 5000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&buffer, p]() {
+            for (int i = 0; i < perProducer; ++i) {
+                buffer.push(p * perProducer + i);
+            }
+        });
+    }
+    size_t drained = 0;
+    for (int round = 0; round < 10; ++round) {
+        drained += buffer.drain_into(target); // drains while producers are still pushing
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    drained += buffer.drain_into(target);
+    CHECK(drained == producers * perProducer);
+    CHECK(target.size() == producers * perProducer);
+
+    // each producer's elements keep their relative order
+    std::vector<int> lastSeen(producers, -1);
+    bool ordered = true;
+    for (int v : target.getData()) {
+        int p = v / perProducer;
+        ordered = ordered && v > lastSeen[p];
+        lastSeen[p] = v;
+    }
+    CHECK(ordered);
+    CHECK(buffer.drain_into(target) == 0);
+}
+
+TEST_CASE("IngestBuffer: strings and ConcurrentContainer target") {
+    IngestBuffer<std::string> buffer;
+    ConcurrentContainer<std::string> target;
+    for (int i = 0; i < 3000; ++i) {
+        buffer.push("item" + std::to_string(i));
+    }
+    CHECK(buffer.drain_into(target) == 3000);
+    auto snap = target.snapshot();
+    CHECK(snap.size() == 3000);
+    CHECK(snap[0] == "item0");
+    CHECK(snap[2999] == "item2999");
+
+    IngestBuffer<std::string> leftover; // destroyed with undrained elements
+    leftover.push("never drained");
+}
+
+TEST_CASE("ShardedContainer: every order matches a plain MyContainer") {
+    ShardedContainer<int, 4> sharded;
+    MyContainer<int> reference;
+    for (int i = 0; i < 500; ++i) {
+        int v = (i * 31) % 97;
+        sharded.add(v);
+        reference.add(v);
+    }
+    sharded.remove(13);
+    reference.remove(13);
+    CHECK_THROWS_WITH(sharded.remove(1000), "Element not found in container.");
+    CHECK(sharded.size() == reference.size());
+
+    const Order orders[] = {Order::Ascending, Order::Descending, Order::SideCross,
+                            Order::Reverse, Order::Normal, Order::MiddleOut};
+    for (Order order : orders) {
+        CHECK(sharded.to_vector(order) == reference.to_vector(order));
+    }
+    std::vector<int> visited;
+    sharded.visit<Order::MiddleOut>([&visited](int v) { visited.push_back(v); });
+    CHECK(visited == reference.to_vector(Order::MiddleOut));
+
+    size_t nonEmpty = 0;
+    for (size_t s = 0; s < 4; ++s) {
+        nonEmpty += sharded.shard_size(s) > 0;
+    }
+    CHECK(nonEmpty == 4);
+}
+
+TEST_CASE("ShardedContainer: concurrent add and remove") {
+    ShardedContainer<int, 8> sharded;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&sharded, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                sharded.add(t * 10000 + i);
+            }
+            for (int i = 0; i < 2000; i += 2) {
+                sharded.remove(t * 10000 + i);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(sharded.size() == 4000);
+    auto ascending = sharded.to_vector(Order::Ascending);
+    CHECK(std::is_sorted(ascending.begin(), ascending.end()));
+    auto normal = sharded.to_vector(Order::Normal);
+    CHECK(normal.size() == 4000);
+}
+
+TEST_CASE("Copy-on-write: copies share storage until mutated") {
+    MyContainer<int> original;
+    for (int i = 0; i < 100; ++i) {
+        original.add(100 - i);
+    }
+    MyContainer<int> copy = original;
+    CHECK(copy.getData().data() == original.getData().data()); // O(1) copy, shared storage
+
+    copy.add(500);
+    CHECK(copy.getData().data() != original.getData().data()); // the mutated copy detached
+    CHECK(original.size() == 100);
+    CHECK(copy.size() == 101);
+    CHECK(original.getData().back() == 1);
+
+    MyContainer<int> assigned;
+    assigned.add(7);
+    assigned = original;
+    assigned.remove(50);
+    CHECK(assigned.size() == 99);
+    CHECK(original.size() == 100);
+    CHECK_THROWS_WITH(assigned.remove(50), "Element not found in container.");
+
+    MyContainer<int> moved = std::move(copy);
+    CHECK(moved.size() == 101);
+}
+
+TEST_CASE("Copy-on-write: sorted snapshot is shared until either copy is mutated") {
+    MyContainer<int> a;
+    a.add(3);
+    a.add(1);
+    a.add(2);
+    const int* smallest = &*a.begin_ascending_order();
+    CHECK(&*a.begin_ascending_order() == smallest); // cached, not re-sorted
+
+    MyContainer<int> b = a;
+    CHECK(&*b.begin_ascending_order() == smallest);
+    CHECK(&*b.begin_descending_order() != nullptr);
+
+    b.add(0);
+    CHECK(*b.begin_ascending_order() == 0);
+    CHECK(*a.begin_ascending_order() == 1);
+    CHECK(&*a.begin_ascending_order() == smallest); // a keeps its snapshot
+}
+
+TEST_CASE("Background sort: snapshot is rebuilt after writes go quiet") {
+    MyContainer<int> c;
+    c.enable_background_sort(std::chrono::milliseconds(1));
+    CHECK(c.background_sort_enabled());
+    for (int i = 0; i < 10000; ++i) {
+        c.add((i * 7919) % 10007);
+    }
+
+    // wait for the background build to finish
+    for (int tries = 0; tries < 2000 && c.background_sort_stats().background_builds == 0; ++tries) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(c.background_sort_stats().background_builds >= 1);
+
+    std::vector<int> ascending;
+    for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+        ascending.push_back(*it);
+    }
+    CHECK(ascending.size() == 10000);
+    CHECK(std::is_sorted(ascending.begin(), ascending.end()));
+    BackgroundSortStats stats = c.background_sort_stats();
+    CHECK(stats.background_hits + stats.waited_for_background == 1);
+    CHECK(stats.synchronous_builds == 0);
+
+    // a write followed immediately by a read may fall back to a synchronous build, but stays correct
+    c.add(-1);
+    CHECK(*c.begin_ascending_order() == -1);
+    stats = c.background_sort_stats();
+    CHECK(stats.background_hits + stats.waited_for_background + stats.synchronous_builds == 2);
+
+    MyContainer<int> copy = c; // background mode is not inherited
+    CHECK_FALSE(copy.background_sort_enabled());
+    MyContainer<int> moved = std::move(c);
+    CHECK(moved.background_sort_enabled());
+    moved.remove(-1);
+    CHECK(moved.size() == 10000);
+    moved.disable_background_sort();
+    CHECK(moved.background_sort_stats().background_builds == 0);
+}
+
+TEST_CASE("Order statistics: kth_smallest, median, percentile, rank") {
+    MyContainer<int> c;
+    for (int v : {9, 1, 8, 2, 7, 3, 6, 4, 5, 10}) {
+        c.add(v);
+    }
+    // no sorted snapshot yet: selection path
+    CHECK(c.kth_smallest(0) == 1);
+    CHECK(c.kth_smallest(9) == 10);
+    CHECK(c.median() == doctest::Approx(5.5));
+    CHECK(c.percentile(0) == doctest::Approx(1));
+    CHECK(c.percentile(100) == doctest::Approx(10));
+    CHECK(c.percentile(25) == doctest::Approx(3.25));
+    CHECK(c.rank(5) == 4);
+    CHECK(c.rank(0) == 0);
+    CHECK(c.rank(11) == 10);
+
+    // with the sorted snapshot built, answers are identical
+    c.begin_ascending_order();
+    CHECK(c.kth_smallest(3) == 4);
+    CHECK(c.median() == doctest::Approx(5.5));
+    CHECK(c.rank(5) == 4);
+
+    std::vector<double> ps = {99, 1, 50, 50};
+    auto batch = c.percentiles(ps);
+    CHECK(batch.size() == 4);
+    CHECK(batch[0] == doctest::Approx(c.percentile(99)));
+    CHECK(batch[2] == doctest::Approx(5.5));
+
+    CHECK_THROWS_WITH(c.kth_smallest(10), "kth_smallest: k out of range.");
+    CHECK_THROWS_WITH(c.percentile(101), "percentile: p must be within [0, 100].");
+    MyContainer<int> empty;
+    CHECK_THROWS_WITH(empty.median(), "percentile: container is empty.");
+}
+
+TEST_CASE("Order statistics: batch selection matches sorting on random data") {
+    MyContainer<int> c;
+    unsigned x = 12345;
+    for (int i = 0; i < 5000; ++i) {
+        x = x * 1103515245u + 12345u;
+        c.add(static_cast<int>((x >> 8) % 1000));
+    }
+    std::vector<int> sorted = c.to_vector(Order::Normal);
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<double> ps = {0, 10, 33.3, 50, 90, 99.9, 100};
+    auto batch = c.percentiles(ps);
+    for (size_t i = 0; i < ps.size(); ++i) {
+        double pos = ps[i] / 100.0 * (sorted.size() - 1);
+        size_t lo = static_cast<size_t>(pos);
+        size_t hi = std::min(sorted.size() - 1, lo + 1);
+        double expected = sorted[lo] + (pos - lo) * (sorted[hi] - sorted[lo]);
+        CHECK(batch[i] == doctest::Approx(expected));
+    }
+
+    MyContainer<std::string> words;
+    for (const char* w : {"pear", "apple", "fig", "kiwi"}) {
+        words.add(w);
+    }
+    CHECK(words.median() == "fig");
+    CHECK(words.kth_smallest(3) == "pear");
+    CHECK(words.rank("banana") == 1);
+}
+
+TEST_CASE("top_k / bottom_k: bounded heap matches full sort") {
+    MyContainer<int> c;
+    unsigned x = 7;
+    for (int i = 0; i < 10000; ++i) {
+        x = x * 1664525u + 1013904223u;
+        c.add(static_cast<int>(x >> 12));
+    }
+    std::vector<int> sorted = c.to_vector(Order::Normal);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<int> top = c.top_k(100);
+    CHECK(top.size() == 100);
+    CHECK(std::equal(top.begin(), top.end(), sorted.rbegin()));
+    std::vector<int> bottom = c.bottom_k(37);
+    CHECK(std::equal(bottom.begin(), bottom.end(), sorted.begin()));
+
+    c.begin_ascending_order(); // the snapshot path gives the same answer
+    CHECK(c.top_k(100) == top);
+    CHECK(c.bottom_k(37) == bottom);
+    CHECK(c.top_k(20000).size() == 10000);
+    CHECK(c.top_k(0).empty());
+
+    MyContainer<std::string> words;
+    for (const char* w : {"pear", "apple", "fig", "kiwi"}) {
+        words.add(w);
+    }
+    CHECK(words.top_k(2) == std::vector<std::string>{"pear", "kiwi"});
+    CHECK(words.bottom_k(2) == std::vector<std::string>{"apple", "fig"});
+}
+
+TEST_CASE("tracked_top_k: maintained by add and rebuilt after remove") {
+    MyContainer<int> c;
+    CHECK_THROWS_WITH(c.tracked_top_k(), "tracked_top_k: tracking is not enabled.");
+    c.add(5);
+    c.add(1);
+    c.track_top_k(3);
+    CHECK(c.tracked_top_k() == std::vector<int>{5, 1});
+    c.add(9);
+    c.add(7);
+    c.add(2);
+    CHECK(c.tracked_top_k() == std::vector<int>{9, 7, 5});
+    c.remove(1); // below the tracked set, stays current
+    CHECK(c.tracked_top_k() == std::vector<int>{9, 7, 5});
+    c.remove(9);
+    CHECK(c.tracked_top_k() == std::vector<int>{7, 5, 2});
+    std::vector<int> batch = {20, 3};
+    c.add_all(batch);
+    CHECK(c.tracked_top_k() == std::vector<int>{20, 7, 5});
+    MyContainer<int> copy = c;
+    CHECK(copy.tracked_top_k() == std::vector<int>{20, 7, 5});
+}
+
+TEST_CASE("count_in_range / ascending_range: binary-searched slices") {
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2, 6, 9}) {
+        c.add(v);
+    }
+    CHECK(c.count_in_range(2, 9) == 4);
+    CHECK(c.count_in_range(6, 7) == 2);
+    CHECK(c.count_in_range(100, 200) == 0);
+    CHECK(c.count_in_range(9, 2) == 0);
+
+    SortedRange<int> r = c.ascending_range(2, 9);
+    CHECK(std::vector<int>(r.begin(), r.end()) == std::vector<int>{2, 6, 6, 7});
+    CHECK(r[0] == 2);
+    c.add(3); // the range keeps its snapshot
+    CHECK(std::vector<int>(r.begin(), r.end()) == std::vector<int>{2, 6, 6, 7});
+    CHECK(c.count_in_range(2, 9) == 5);
+    CHECK(c.ascending_range(16, 100).empty());
+}
+
+TEST_CASE("enable_sorted_index: writes keep the sorted snapshot current") {
+    MyContainer<int> c;
+    c.add(5);
+    c.add(1);
+    c.enable_sorted_index();
+    CHECK(c.sorted_index_enabled());
+    c.add(3);
+    c.add(5);
+    std::vector<int> batch = {8, 0, 4};
+    c.add_all(batch);
+    c.remove(5);
+    std::vector<int> expected = {0, 1, 3, 4, 8};
+    CHECK(c.to_vector(Order::Ascending) == expected);
+    std::vector<int> walked;
+    for (auto it = c.begin_ascending_order(); it != c.end_ascending_order(); ++it) {
+        walked.push_back(*it);
+    }
+    CHECK(walked == expected);
+    SortedRange<int> held = c.ascending_range(0, 100);
+    c.add(2); // held shares the index, so this write must not change it
+    CHECK(std::vector<int>(held.begin(), held.end()) == expected);
+    CHECK(c.count_in_range(1, 4) == 3);
+
+    MyContainer<int> copy = c;
+    copy.add(-1);
+    CHECK(copy.to_vector(Order::Ascending).front() == -1);
+    CHECK(c.to_vector(Order::Ascending).front() == 0);
+
+    MyContainer<int> other;
+    other.add(9);
+    other.add(6);
+    c = other;
+    c.add(7);
+    CHECK(c.to_vector(Order::Ascending) == std::vector<int>{6, 7, 9});
+    c.disable_sorted_index();
+    CHECK_FALSE(c.sorted_index_enabled());
+    c.add(1);
+    CHECK(c.to_vector(Order::Ascending) == std::vector<int>{1, 6, 7, 9});
+}
+
+TEST_CASE("min / max: maintained by add, recomputed after removing an extreme") {
+    MyContainer<int> c;
+    CHECK_THROWS_WITH(c.min(), "min: container is empty.");
+    CHECK_THROWS_WITH(c.max(), "max: container is empty.");
+    c.add(5);
+    CHECK(c.min() == 5);
+    CHECK(c.max() == 5);
+    c.add(9);
+    c.add(-2);
+    c.add(4);
+    CHECK(c.min() == -2);
+    CHECK(c.max() == 9);
+    c.remove(4); // not an extreme
+    CHECK(c.min() == -2);
+    c.remove(-2);
+    CHECK(c.min() == 5);
+    c.remove(9);
+    CHECK(c.max() == 5);
+
+    std::vector<int> batch;
+    for (int i = 0; i < 100; ++i) {
+        batch.push_back((i * 37) % 101 - 50);
+    }
+    MyContainer<int> big;
+    big.add_all(batch);
+    CHECK(big.min() == *std::min_element(batch.begin(), batch.end()));
+    CHECK(big.max() == *std::max_element(batch.begin(), batch.end()));
+    big.remove(big.max());
+    std::vector<int> rest = big.getData();
+    CHECK(big.max() == *std::max_element(rest.begin(), rest.end()));
+
+    MyContainer<int> assigned;
+    assigned = c;
+    CHECK(assigned.max() == 5);
+}
+
+TEST_CASE("SideCrossIterator: begin() pins the storage and sorts only past min/max") {
+    MyContainer<int> pair;
+    pair.add(9);
+    pair.add(4);
+    auto p = pair.begin_side_cross_order();
+    CHECK(*p == 4);
+    ++p;
+    CHECK(*p == 9);
+    ++p;
+    CHECK(p == pair.end_side_cross_order());
+
+    MyContainer<int> shrinking;
+    for (int v : {5, 1, 9, 3}) {
+        shrinking.add(v);
+    }
+    auto s = shrinking.begin_side_cross_order();
+    ++s;
+    ++s;
+    shrinking.remove(5);
+    shrinking.remove(1);
+    shrinking.remove(9);
+    CHECK(*s == 3);
+    ++s;
+    CHECK(*s == 5);
+
+    MyContainer<int> c;
+    for (int v : {7, 15, 6, 1, 2}) {
+        c.add(v);
+    }
+    auto it = c.begin_side_cross_order();
+    CHECK(*it == 1);
+    ++it;
+    CHECK(*it == 15);
+    c.remove(15);
+    std::vector<int> order;
+    for (auto s = c.begin_side_cross_order(); s != c.end_side_cross_order(); ++s) {
+        order.push_back(*s);
+    }
+    CHECK(order == std::vector<int>{1, 7, 2, 6});
+    CHECK(c.to_vector(Order::SideCross) == order);
+
+    // begin() and the first two elements do not sort; changes after begin() are not seen
+    MyContainer<int> lazy;
+    for (int v : {8, 3, 12, 5, 10}) {
+        lazy.add(v);
+    }
+    auto l = lazy.begin_side_cross_order();
+    CHECK(*l == 3);
+    ++l;
+    CHECK(*l == 12);
+    CHECK_FALSE(lazy.sorted_snapshot_ready());
+    lazy.remove(5);
+    lazy.add(-1);
+    ++l;
+    CHECK(*l == 5);
+    ++l;
+    CHECK(*l == 10);
+    ++l;
+    CHECK(*l == 8);
+    CHECK(lazy.min() == -1);
+}
+
+TEST_CASE("sum / mean / variance / minmax: blocked reductions") {
+    MyContainer<int> ints;
+    CHECK(ints.sum() == 0);
+    CHECK_THROWS_WITH(ints.mean(), "mean: container is empty.");
+    CHECK_THROWS_WITH(ints.variance(), "variance: container is empty.");
+    CHECK_THROWS_WITH(ints.minmax(), "minmax: container is empty.");
+    for (int v : {2, 4, 4, 4, 5, 5, 7, 9}) {
+        ints.add(v);
+    }
+    CHECK(ints.sum() == 40);
+    CHECK(ints.mean() == doctest::Approx(5.0));
+    CHECK(ints.variance() == doctest::Approx(4.0));
+    CHECK(ints.minmax() == std::pair<int, int>{2, 9});
+
+    MyContainer<double> d;
+    std::vector<double> values;
+    for (int i = 0; i < 3 * 4096 + 123; ++i) {
+        values.push_back(1.0 / (1 + i % 977) + (i % 5) * 1e-3);
+    }
+    d.add_all(values);
+    const double single = d.sum();
+    CHECK(d.sum(2) == single); // bit-identical for any thread count
+    CHECK(d.sum(3) == single);
+    CHECK(d.sum(0) == single);
+    CHECK(d.variance(4) == d.variance());
+    CHECK(single == doctest::Approx(std::accumulate(values.begin(), values.end(), 0.0)));
+    d.remove(d.max());
+    auto [lo, hi] = d.minmax(4);
+    std::vector<double> rest = d.getData();
+    CHECK(lo == *std::min_element(rest.begin(), rest.end()));
+    CHECK(hi == *std::max_element(rest.begin(), rest.end()));
+}
+
+TEST_CASE("find / contains / count: SIMD scans agree with the scalar definition") {
+    MyContainer<int> ints;
+    CHECK(ints.find(1) == MyContainer<int>::npos);
+    CHECK_FALSE(ints.contains(1));
+    for (int i = 0; i < 1000; ++i) {
+        ints.add(i % 7);
+    }
+    ints.add(42);
+    CHECK(ints.find(42) == 1000);
+    CHECK(ints.find(3) == 3);
+    CHECK(ints.contains(6));
+    CHECK_FALSE(ints.contains(7));
+    CHECK(ints.count(0) == 143);
+    ints.remove(0);
+    CHECK(ints.size() == 858);
+    CHECK(ints.count(0) == 0);
+    CHECK(ints.getData()[0] == 1);
+    CHECK(ints.getData().back() == 42);
+    CHECK(ints.count(6) == 142);
+
+    MyContainer<double> d;
+    for (int i = 0; i < 37; ++i) {
+        d.add(i * 0.5);
+    }
+    d.add(-0.0);
+    CHECK(d.find(0.0) == 0); // -0.0 == 0.0, as with operator==
+    CHECK(d.count(0.0) == 2);
+    CHECK(d.find(17.5) == 35);
+    d.remove(0.0);
+    CHECK(d.size() == 36);
+    CHECK(d.getData().back() == 18.0);
+
+    MyContainer<float> f;
+    for (int i = 0; i < 20; ++i) {
+        f.add(static_cast<float>(i % 3));
+    }
+    CHECK(f.count(2.0f) == 6);
+    CHECK(f.find(2.0f) == 2);
+
+    MyContainer<std::string> s;
+    s.add("a");
+    s.add("b");
+    CHECK(s.find("b") == 1);
+    CHECK(s.count("a") == 1);
+    CHECK(std::string(simd::scan_kernels<int>().isa).size() > 0);
+#if CONTAINER_SIMD_X86
+    std::vector<int> raw = {5, 1, 5, 2, 3, 5, 4, 4, 9, 5, 1};
+    CHECK(simd::kernels::findSse2(raw.data(), raw.size(), 9) == 8);
+    CHECK(simd::kernels::countSse2(raw.data(), raw.size(), 5) == 4);
+#endif
+}
+
+TEST_CASE("approx_percentile: KLL sketch stays within its rank error and merges") {
+    MyContainer<int> c;
+    CHECK_THROWS_WITH(c.approx_percentile(50), "approx_percentile: quantile sketch is not enabled.");
+    c.enable_quantile_sketch();
+    CHECK_THROWS_WITH(c.approx_percentile(50), "approx_percentile: container is empty.");
+    const int n = 100000;
+    for (int i = 0; i < n; ++i) {
+        c.add(static_cast<int>((static_cast<long long>(i) * 7919) % n)); // a permutation of 0..n-1
+    }
+    const double eps = c.quantile_sketch().normalized_rank_error();
+    CHECK(c.quantile_sketch().retained() < 2000);
+    for (double p : {1.0, 50.0, 99.0, 99.9}) {
+        const double got = c.approx_percentile(p);
+        CHECK(std::abs(got - p / 100 * n) <= 2 * eps * n);
+    }
+    CHECK_THROWS_WITH(c.approx_percentile(101), "approx_percentile: p must be within [0, 100].");
+
+    MyContainer<int> high;
+    high.enable_quantile_sketch();
+    for (int i = n; i < 2 * n; ++i) {
+        high.add(i);
+    }
+    KllSketch<int> merged = c.quantile_sketch();
+    merged.merge(high.quantile_sketch());
+    CHECK(merged.size() == 2 * n);
+    CHECK(std::abs(merged.quantile(0.5) - n) <= 2 * eps * 2 * n);
+    CHECK(std::abs(merged.quantile(0.25) - n / 2.0) <= 2 * eps * 2 * n);
+
+    MyContainer<int> small;
+    small.enable_quantile_sketch();
+    for (int v : {5, 1, 9}) {
+        small.add(v);
+    }
+    small.remove(9); // rebuilt on the next query
+    CHECK(small.approx_percentile(100) == 5);
+    CHECK(small.approx_percentile(0) == 1);
+
+    MyContainer<int> precise;
+    precise.enable_quantile_sketch_with_error(0.005);
+    CHECK(precise.quantile_sketch().normalized_rank_error() <= 0.005);
+    CHECK(KllSketch<int>::with_error(0.005).normalized_rank_error() <= 0.005);
+    for (int i = 0; i < n; ++i) {
+        precise.add(static_cast<int>((static_cast<long long>(i) * 7919) % n));
+    }
+    for (double p : {1.0, 50.0, 99.0}) {
+        CHECK(std::abs(precise.approx_percentile(p) - p / 100 * n) <= 2 * 0.005 * n);
+    }
+    CHECK_THROWS_AS(precise.enable_quantile_sketch_with_error(0), std::invalid_argument);
+    CHECK_THROWS_AS(precise.enable_quantile_sketch_with_error(1.5), std::invalid_argument);
+}
+
+TEST_CASE("enable_bloom_filter: absent values are rejected, present ones always found") {
+    MyContainer<int> c;
+    c.add(-1);
+    c.enable_bloom_filter();
+    CHECK(c.bloom_filter_enabled());
+    for (int i = 0; i < 5000; ++i) { // grows past the initial capacity, forcing rebuilds
+        c.add(i * 2);
+    }
+    std::vector<int> batch = {100001, 100003};
+    c.add_all(batch);
+    size_t missing = 0;
+    for (int i = 0; i < 5000; ++i) {
+        missing += !c.contains(i * 2);
+    }
+    CHECK(missing == 0); // no false negatives
+    CHECK(c.contains(-1));
+    CHECK(c.contains(100003));
+    CHECK(c.count(100001) == 1);
+    size_t falsePositives = 0;
+    for (int i = 0; i < 5000; ++i) {
+        falsePositives += c.contains(i * 2 + 1);
+    }
+    CHECK(falsePositives == 0); // the scan still answers exactly
+    CHECK_THROWS_WITH(c.remove(7), "Element not found in container.");
+
+    for (int i = 0; i < 4000; ++i) { // enough removals to trigger a rebuild
+        c.remove(i * 2);
+    }
+    CHECK_FALSE(c.contains(0));
+    CHECK(c.contains(9998));
+
+    MyContainer<int> copy = c;
+    copy.add(77777);
+    CHECK(copy.contains(77777));
+    CHECK_FALSE(c.contains(77777));
+    c.disable_bloom_filter();
+    CHECK(c.contains(9998));
+}
+
+TEST_CASE("approx_distinct / exact_distinct") {
+    MyContainer<int> c;
+    CHECK(c.exact_distinct() == 0);
+    CHECK(c.approx_distinct() == 0);
+    c.enable_distinct_sketch();
+    for (int i = 0; i < 50000; ++i) {
+        c.add(i % 20000);
+    }
+    CHECK(c.exact_distinct() == 20000);
+    const double err = HyperLogLog<int>().relative_error();
+    CHECK(std::abs(static_cast<double>(c.approx_distinct()) - 20000) <= 4 * err * 20000);
+    c.remove(5);
+    c.remove(6);
+    CHECK(c.exact_distinct() == 19998);
+    CHECK(std::abs(static_cast<double>(c.approx_distinct()) - 19998) <= 4 * err * 19998);
+
+    MyContainer<std::string> words;
+    for (const char* w : {"a", "b", "a", "c", "b"}) {
+        words.add(w);
+    }
+    CHECK(words.exact_distinct() == 3);
+    CHECK(words.approx_distinct() == 3); // linear counting is exact-ish for tiny sets
+
+    HyperLogLog<int> left;
+    HyperLogLog<int> right;
+    for (int i = 0; i < 3000; ++i) {
+        left.add(i);
+        right.add(i + 1500);
+    }
+    left.merge(right);
+    CHECK(std::abs(left.estimate() - 4500) <= 4 * err * 4500);
+    CHECK_THROWS_AS(left.merge(HyperLogLog<int>(10)), std::invalid_argument);
+}
+
+TEST_CASE("merge / merge_all: data is moved and sorted snapshots are merged") {
+    MyContainer<int> a;
+    MyContainer<int> b;
+    for (int v : {5, 1, 9}) {
+        a.add(v);
+    }
+    for (int v : {4, 8, 2, 9}) {
+        b.add(v);
+    }
+    a.begin_ascending_order(); // a has a ready snapshot, b does not
+    a.merge(std::move(b));
+    CHECK(b.size() == 0);
+    CHECK(a.getData() == std::vector<int>{5, 1, 9, 4, 8, 2, 9});
+    CHECK(a.to_vector(Order::Ascending) == std::vector<int>{1, 2, 4, 5, 8, 9, 9});
+    CHECK(a.min() == 1);
+    CHECK(a.max() == 9);
+
+    std::vector<MyContainer<int>> workers(5);
+    std::vector<int> all;
+    for (int w = 0; w < 5; ++w) {
+        for (int i = 0; i < 40; ++i) {
+            int v = (i * 31 + w * 17) % 101;
+            workers[w].add(v);
+            all.push_back(v);
+        }
+        if (w % 2 == 0) {
+            workers[w].begin_ascending_order();
+        }
+    }
+    MyContainer<int> total;
+    total.add(50);
+    all.insert(all.begin(), 50);
+    total.merge_all(workers);
+    CHECK(total.getData() == all);
+    std::sort(all.begin(), all.end());
+    CHECK(total.to_vector(Order::Ascending) == all);
+    for (const auto& w : workers) {
+        CHECK(w.size() == 0);
+    }
+
+    MyContainer<int> indexed;
+    indexed.add(3);
+    indexed.enable_sorted_index();
+    MyContainer<int> more;
+    more.add(1);
+    indexed.merge(std::move(more));
+    CHECK(indexed.to_vector(Order::Ascending) == std::vector<int>{1, 3});
+}
+
+TEST_CASE("merge: owned storage is adopted, shared storage is left intact, options survive") {
+    MyContainer<int> source;
+    for (int v : {4, 2, 8}) {
+        source.add(v);
+    }
+    source.enable_bloom_filter();
+    source.track_top_k(2);
+    const int* buffer = source.as_span().data();
+    MyContainer<int> empty;
+    empty.merge(std::move(source));
+    CHECK(empty.as_span().data() == buffer);
+    CHECK(empty.getData() == std::vector<int>{4, 2, 8});
+    CHECK(source.size() == 0);
+    CHECK(source.bloom_filter_enabled());
+    CHECK(source.tracked_top_k().empty());
+    CHECK(!source.contains(4));
+    source.add(6);
+    CHECK(source.tracked_top_k() == std::vector<int>{6});
+
+    MyContainer<int> shared;
+    for (int v : {1, 3}) {
+        shared.add(v);
+    }
+    MyContainer<int> keeper = shared;
+    empty.merge(std::move(shared));
+    CHECK(empty.getData() == std::vector<int>{4, 2, 8, 1, 3});
+    CHECK(keeper.getData() == std::vector<int>{1, 3});
+    CHECK(shared.size() == 0);
+}
+
+TEST_CASE("merge_runs: loser tree matches a full sort") {
+    std::vector<std::vector<int>> parts = {{1, 4, 9}, {}, {2, 2, 3}, {0, 10}, {5}, {4, 6, 7, 8}};
+    std::vector<std::span<const int>> runs(parts.begin(), parts.end());
+    std::vector<int> out;
+    detail::merge_runs(runs, out);
+    CHECK(out == std::vector<int>{0, 1, 2, 2, 3, 4, 4, 5, 6, 7, 8, 9, 10});
+}
+
+TEST_CASE("set operations: multiset semantics over the sorted snapshots") {
+    MyContainer<int> a;
+    MyContainer<int> b;
+    for (int v : {5, 1, 3, 3, 7, 9}) {
+        a.add(v);
+    }
+    for (int v : {3, 4, 9, 1, 3, 3}) {
+        b.add(v);
+    }
+    CHECK(a.set_union(b).getData() == std::vector<int>{1, 3, 3, 3, 4, 5, 7, 9});
+    CHECK(a.set_intersection(b).getData() == std::vector<int>{1, 3, 3, 9});
+    CHECK(a.set_difference(b).getData() == std::vector<int>{5, 7});
+    CHECK(a.set_symmetric_difference(b).getData() == std::vector<int>{3, 4, 5, 7});
+
+    MyContainer<int> result = a.set_union(b);
+    result.add(0); // the shared snapshot is detached, not modified
+    CHECK(result.to_vector(Order::Ascending).front() == 0);
+    CHECK(result.getData().back() == 0);
+
+    MyContainer<std::string> w1;
+    MyContainer<std::string> w2;
+    w1.add("pear");
+    w1.add("fig");
+    w2.add("fig");
+    CHECK(w1.set_intersection(w2).getData() == std::vector<std::string>{"fig"});
+}
+
+TEST_CASE("set_intersection: galloping path matches std::set_intersection") {
+    MyContainer<int> big;
+    MyContainer<int> small;
+    std::vector<int> bigValues;
+    for (int i = 0; i < 20000; ++i) {
+        bigValues.push_back((i * 7) % 15000); // duplicates included
+    }
+    big.add_all(bigValues);
+    std::vector<int> smallValues = {-5, 0, 0, 0, 7, 14, 14, 333, 9999, 14999, 14999, 20000};
+    small.add_all(smallValues);
+    std::sort(bigValues.begin(), bigValues.end());
+    std::sort(smallValues.begin(), smallValues.end());
+    std::vector<int> expected;
+    std::set_intersection(smallValues.begin(), smallValues.end(), bigValues.begin(), bigValues.end(),
+                          std::back_inserter(expected));
+    CHECK(small.set_intersection(big).getData() == expected);
+    CHECK(big.set_intersection(small).getData() == expected);
+}
+
+TEST_CASE("operator<< / write_to: buffered formatting matches the stream format") {
+    MyContainer<double> d;
+    for (double v : {1.0 / 3, 1e6, -0.5, 2.0, 1234567.0}) {
+        d.add(v);
+    }
+    std::ostringstream fast;
+    fast << d;
+    std::ostringstream legacy;
+    legacy << "[ ";
+    for (size_t i = 0; i < d.size(); ++i) {
+        legacy << (i ? ", " : "") << d.getData()[i];
+    }
+    legacy << " ]";
+    CHECK(fast.str() == legacy.str());
+    CHECK(fast.str() == "[ 0.333333, 1e+06, -0.5, 2, 1.23457e+06 ]");
+
+    std::ostringstream precise;
+    precise.precision(3);
+    precise << d;
+    CHECK(precise.str() == "[ 0.333, 1e+06, -0.5, 2, 1.23e+06 ]");
+    std::ostringstream hex;
+    MyContainer<int> ints;
+    for (int v : {10, 255, -3}) {
+        ints.add(v);
+    }
+    hex << std::hex << ints; // custom flags take the per-element path
+    CHECK(hex.str() == "[ a, ff, fffffffd ]");
+
+    std::FILE* tmp = std::tmpfile();
+    REQUIRE(tmp != nullptr);
+    ints.write_to(tmp, Order::Ascending);
+    std::fflush(tmp); // the descriptor write below bypasses the FILE buffer
+    ints.write_to(fileno(tmp), Order::SideCross);
+    std::rewind(tmp);
+    char text[128] = {};
+    size_t got = std::fread(text, 1, sizeof(text) - 1, tmp);
+    std::fclose(tmp);
+    CHECK(std::string(text, got) == "[ -3, 10, 255 ][ -3, 255, 10 ]");
+
+    MyContainer<int> big;
+    std::vector<int> values(50000);
+    for (int i = 0; i < 50000; ++i) {
+        values[i] = i * 37 - 900000;
+    }
+    big.add_all(values);
+    std::ostringstream bigFast;
+    bigFast << big;
+    std::ostringstream bigLegacy;
+    bigLegacy << "[ ";
+    for (size_t i = 0; i < values.size(); ++i) {
+        bigLegacy << (i ? ", " : "") << values[i];
+    }
+    bigLegacy << " ]";
+    CHECK(bigFast.str() == bigLegacy.str()); // spans many buffer flushes
+
+    MyContainer<std::string> words;
+    words.add("hello");
+    words.add("world");
+    std::ostringstream w;
+    w << words;
+    CHECK(w.str() == "[ hello, world ]");
+
+    // a locale with digit grouping takes the per-element path too
+    struct Grouped : std::numpunct<char> {
+        char do_thousands_sep() const override {
+            return '\'';
+        }
+        std::string do_grouping() const override {
+            return "\3";
+        }
+    };
+    std::ostringstream grouped;
+    grouped.imbue(std::locale(std::locale::classic(), new Grouped));
+    MyContainer<int> thousands;
+    thousands.add(1234567);
+    thousands.add(12);
+    grouped << thousands;
+    CHECK(grouped.str() == "[ 1'234'567, 12 ]");
+}
+
+TEST_CASE("save_binary / load_binary / map_binary round trips") {
+    MyContainer<int> ints;
+    for (int v : {7, -15, 6, 1, 2147483647}) {
+        ints.add(v);
+    }
+    std::stringstream buffer;
+    ints.save_binary(buffer);
+    CHECK(buffer.str().size() == binary::header_size + 5 * sizeof(int));
+    CHECK(buffer.str().substr(0, 8) == "MYCONTNR");
+    MyContainer<int> back = MyContainer<int>::load_binary(buffer);
+    CHECK(back.getData() == ints.getData());
+
+    std::stringstream wrongType(buffer.str());
+    CHECK_THROWS_WITH(MyContainer<double>::load_binary(wrongType), "load_binary: element type mismatch.");
+    std::stringstream garbage("definitely not a container file....");
+    CHECK_THROWS_WITH(MyContainer<int>::load_binary(garbage), "load_binary: not a MyContainer file.");
+    std::stringstream cut(buffer.str().substr(0, buffer.str().size() - 2));
+    CHECK_THROWS_WITH(MyContainer<int>::load_binary(cut), "load_binary: file is truncated.");
+
+    MyContainer<std::string> words;
+    words.add("alpha");
+    words.add("");
+    words.add("with, comma");
+    std::stringstream wordBuffer;
+    words.save_binary(wordBuffer);
+    CHECK(MyContainer<std::string>::load_binary(wordBuffer).getData() == words.getData());
+    // a corrupt string length is reported as truncation, not allocated up front
+    std::string corrupt = wordBuffer.str();
+    for (size_t b = 0; b < 7; ++b) {
+        corrupt[binary::header_size + b] = static_cast<char>(0xff);
+    }
+    std::stringstream corruptBuffer(corrupt);
+    CHECK_THROWS_WITH(MyContainer<std::string>::load_binary(corruptBuffer), "load_binary: file is truncated.");
+
+    MyContainer<double> d;
+    std::vector<double> values;
+    for (int i = 0; i < 10000; ++i) {
+        values.push_back(i * 0.25 - 7);
+    }
+    d.add_all(values);
+    const std::string path = "test_container_binary.bin";
+    d.save_binary(path);
+    CHECK(MyContainer<double>::load_binary(path).getData() == values);
+    {
+        MappedContainer<double> mapped = MyContainer<double>::map_binary(path);
+        CHECK(mapped.size() == values.size());
+        CHECK(mapped[9999] == values[9999]);
+        CHECK(std::equal(mapped.begin(), mapped.end(), values.begin()));
+        CHECK_THROWS_AS(mapped[10000], std::out_of_range);
+        MyContainer<double> copy;
+        copy.add_all(mapped.as_span());
+        CHECK(copy.getData() == values);
+    }
+    CHECK_THROWS_WITH(MyContainer<float>::map_binary(path), "load_binary: element type mismatch.");
+    std::remove(path.c_str());
+
+    MyContainer<int> empty;
+    std::stringstream emptyBuffer;
+    empty.save_binary(emptyBuffer);
+    CHECK(MyContainer<int>::load_binary(emptyBuffer).size() == 0);
+}
+
+TEST_CASE("load_text parses delimited numbers in parallel chunks") {
+    const std::string path = "test_container_text.txt";
+    {
+        std::ofstream out(path);
+        out << "7\n-15\n\n6\r\n  1\n2147483647";
+    }
+    CHECK(MyContainer<int>::load_text(path).getData() == std::vector<int>{7, -15, 6, 1, 2147483647});
+
+    {
+        std::ofstream out(path);
+        out << "0.5,-2.25,1e3\n4,,5\n";
+    }
+    CHECK(MyContainer<double>::load_text(path, ',').getData() == std::vector<double>{0.5, -2.25, 1000, 4, 5});
+
+    // large enough to be split between several threads; the result keeps file order
+    std::vector<int> expected;
+    {
+        std::ofstream out(path);
+        for (int i = 0; i < 600000; ++i) {
+            // spread over most of the int range; computed in 64 bits so nothing overflows
+            const std::int64_t wide = static_cast<std::int64_t>(i) * 7919 % 4000000000 - 2000000000;
+            expected.push_back(static_cast<int>(wide));
+            out << expected.back() << (i % 5 == 4 ? '\n' : ',');
+        }
+    }
+    CHECK(MyContainer<int>::load_text(path, ',', 4).getData() == expected);
+    CHECK(MyContainer<int>::load_text(path, ',', 1).getData() == expected);
+
+    {
+        std::ofstream out(path);
+        out << "1\n2\nthree\n4\n";
+    }
+    CHECK_THROWS_WITH(MyContainer<int>::load_text(path), "load_text: invalid number at byte 4.");
+    {
+        std::ofstream out(path);
+        out << "1.5\n";
+    }
+    CHECK_THROWS_WITH(MyContainer<int>::load_text(path), "load_text: invalid number at byte 0.");
+    {
+        std::ofstream out(path);
+    }
+    CHECK(MyContainer<int>::load_text(path).size() == 0);
+    std::remove(path.c_str());
+    CHECK_THROWS_AS(MyContainer<int>::load_text(path), std::runtime_error);
+}
+
+TEST_CASE("save_binary with a sorted index restores the sorted snapshot on load") {
+    MyContainer<int> c;
+    for (int v : {7, -15, 6, 1, 7, 2, 0}) {
+        c.add(v);
+    }
+    std::stringstream plain;
+    c.save_binary(plain);
+    std::stringstream indexed;
+    c.save_binary(indexed, true);
+    CHECK(indexed.str().size() == plain.str().size() + 7 * 4 + 8);
+
+    MyContainer<int> loaded = MyContainer<int>::load_binary(indexed);
+    CHECK(loaded.getData() == c.getData());
+    CHECK(loaded.sorted_snapshot_ready());
+    CHECK(!MyContainer<int>::load_binary(plain).sorted_snapshot_ready());
+    std::vector<int> ascending;
+    for (auto it = loaded.begin_ascending_order(); it != loaded.end_ascending_order(); ++it) {
+        ascending.push_back(*it);
+    }
+    CHECK(ascending == std::vector<int>{-15, 0, 1, 2, 6, 7, 7});
+    loaded.add(-100);
+    CHECK(loaded.min() == -100);
+    CHECK(loaded.kth_smallest(0) == -100);
+
+    // a damaged permutation is rejected instead of installing a wrong snapshot
+    std::string bytes = indexed.str();
+    std::swap(bytes[plain.str().size()], bytes[plain.str().size() + 4]);
+    std::stringstream damaged(bytes);
+    CHECK_THROWS_WITH(MyContainer<int>::load_binary(damaged), "load_binary: sorted index is corrupt.");
+    bytes = indexed.str();
+    bytes[plain.str().size()] = 100;
+    std::stringstream outOfRange(bytes);
+    CHECK_THROWS_WITH(MyContainer<int>::load_binary(outOfRange), "load_binary: sorted index is corrupt.");
+    // elements edited after saving no longer match the permutation
+    MyContainer<int> tens;
+    for (int v : {10, 20, 30, 40}) {
+        tens.add(v);
+    }
+    std::stringstream tensIndexed;
+    tens.save_binary(tensIndexed, true);
+    bytes = tensIndexed.str();
+    bytes[binary::header_size] = 99;
+    std::stringstream editedElement(bytes);
+    CHECK_THROWS_WITH(MyContainer<int>::load_binary(editedElement), "load_binary: sorted index is corrupt.");
+    std::stringstream truncated(indexed.str().substr(0, indexed.str().size() - 1));
+    CHECK_THROWS_WITH(MyContainer<int>::load_binary(truncated), "load_binary: file is truncated.");
+
+    MyContainer<std::string> words;
+    for (const char* w : {"pear", "apple", "fig", "apple"}) {
+        words.add(w);
+    }
+    const std::string path = "test_container_sorted.bin";
+    words.save_binary(path, true);
+    MyContainer<std::string> back = MyContainer<std::string>::load_binary(path);
+    CHECK(back.sorted_snapshot_ready());
+    CHECK(back.kth_smallest(3) == "pear");
+    {
+        MappedContainer<int> ignoresIndex = (c.save_binary(path, true), MyContainer<int>::map_binary(path));
+        CHECK(std::equal(ignoresIndex.begin(), ignoresIndex.end(), c.getData().begin(), c.getData().end()));
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("const queries that rebuild lazy caches can run concurrently") {
+    MyContainer<int> c;
+    for (int i = 0; i < 5000; ++i) {
+        c.add(i * 7 % 5003);
+    }
+    c.track_top_k(5);
+    c.enable_quantile_sketch();
+    c.enable_distinct_sketch();
+    c.remove(c.max());
+    c.remove(c.min());
+    struct Results {
+        int min = 0, max = 0, percentile = 0;
+        size_t distinct = 0;
+        std::vector<int> top;
+    } r[4];
+    std::vector<std::thread> readers;
+    for (auto& out : r) {
+        readers.emplace_back([&c, &out]() {
+            out.min = c.min();
+            out.max = c.max();
+            out.top = c.tracked_top_k();
+            out.distinct = c.approx_distinct();
+            out.percentile = c.approx_percentile(50);
+        });
+    }
+    for (auto& t : readers) {
+        t.join();
+    }
+    bool agree = true;
+    for (const auto& out : r) {
+        agree = agree && out.min == r[0].min && out.max == r[0].max && out.top == r[0].top
+            && out.distinct == r[0].distinct && out.percentile == r[0].percentile;
+    }
+    CHECK(agree);
+    CHECK(r[0].min == c.kth_smallest(0));
+    CHECK(r[0].top == c.top_k(5));
+}
+
+TEST_CASE("ascending_view shares the cached snapshot; sharded sorted orders merge the shard views") {
+    MyContainer<int> c;
+    for (int v : {7, -15, 6, 1, 7}) {
+        c.add(v);
+    }
+    SortedRange<int> first = c.ascending_view();
+    SortedRange<int> second = c.ascending_view();
+    CHECK(std::vector<int>(first.begin(), first.end()) == std::vector<int>{-15, 1, 6, 7, 7});
+    CHECK(first.begin() == second.begin());
+    c.add(0);
+    CHECK(c.ascending_view().size() == 6);
+    CHECK(first.size() == 5);
+
+    ShardedContainer<int, 8> sharded;
+    std::vector<int> expected;
+    for (int i = 0; i < 1000; ++i) {
+        const int v = (i * 7919) % 501 - 250;
+        sharded.add(v);
+        expected.push_back(v);
+    }
+    std::sort(expected.begin(), expected.end());
+    CHECK(sharded.to_vector(Order::Ascending) == expected);
+    sharded.remove(expected.front());
+    expected.erase(std::remove(expected.begin(), expected.end(), -250), expected.end());
+    CHECK(sharded.to_vector(Order::Ascending) == expected);
+    std::reverse(expected.begin(), expected.end());
+    CHECK(sharded.to_vector(Order::Descending) == expected);
+}
+
+TEST_CASE("copies: constructor and assignment agree; a sorted result is not copied on its first write") {
+    MyContainer<int> source;
+    for (int v : {3, 1, 2}) {
+        source.add(v);
+    }
+    source.enable_bloom_filter();
+    source.track_top_k(2);
+    MyContainer<int> constructed(source);
+    MyContainer<int> assigned;
+    assigned.enable_sorted_index();
+    assigned = source;
+    for (const MyContainer<int>* c : {&constructed, &assigned}) {
+        CHECK(c->getData() == source.getData());
+        CHECK(c->bloom_filter_enabled());
+        CHECK(!c->sorted_index_enabled());
+        CHECK(c->tracked_top_k() == std::vector<int>{3, 2});
+    }
+
+    MyContainer<int> other;
+    for (int v : {2, 5}) {
+        other.add(v);
+    }
+    MyContainer<int> u = source.set_union(other);
+    CHECK(u.sorted_snapshot_ready());
+    const int* buffer = u.as_span().data();
+    u.remove(5); // compacts in place: the snapshot aliasing the storage does not force a copy
+    CHECK(u.as_span().data() == buffer);
+    CHECK(u.getData() == std::vector<int>{1, 2, 3});
+    CHECK(!u.sorted_snapshot_ready());
+}
+
+/**
+ * @brief Element type with ordering, equality and printing but no std::hash.
+ */
+struct Unhashable {
+    int key;
+    bool operator<(const Unhashable& other) const {
+        return key < other.key;
+    }
+    bool operator==(const Unhashable& other) const {
+        return key == other.key;
+    }
+    friend std::ostream& operator<<(std::ostream& os, const Unhashable& u) {
+        return os << 'u' << u.key;
+    }
+};
+
+TEST_CASE("element types without std::hash support add, remove, merge and copies") {
+    MyContainer<Unhashable> c;
+    for (int k : {3, 1, 2, 1}) {
+        c.add(Unhashable{k});
+    }
+    c.remove(Unhashable{1});
+    CHECK(c.size() == 2);
+    CHECK_THROWS_AS(c.remove(Unhashable{7}), std::runtime_error);
+    MyContainer<Unhashable> other;
+    other.add(Unhashable{0});
+    c.merge(std::move(other));
+    MyContainer<Unhashable> copy(c);
+    MyContainer<Unhashable> assigned;
+    assigned = c;
+    CHECK(assigned.min().key == 0);
+    CHECK(copy.max().key == 3);
+    std::ostringstream os;
+    os << copy;
+    CHECK(os.str() == "[ u3, u2, u0 ]");
+}
+
+TEST_CASE("merge: inputs with a background sorter give up their storage safely") {
+    for (int round = 0; round < 8; ++round) {
+        MyContainer<std::string> target;
+        target.add("target");
+        MyContainer<std::string> input;
+        input.enable_background_sort(std::chrono::milliseconds(0));
+        std::vector<std::string> expected{"target"};
+        std::vector<std::string> batch;
+        for (int i = 0; i < 20000; ++i) {
+            batch.push_back("a longer value that is not inlined " + std::to_string((i * 37) % 20000));
+        }
+        input.add_all(batch);
+        expected.insert(expected.end(), batch.begin(), batch.end());
+        // the input's worker starts copying its storage right away; merge while it may still be at it
+        std::this_thread::sleep_for(std::chrono::microseconds(round * 100));
+        target.merge(std::move(input));
+        CHECK(target.getData() == expected);
+        CHECK(input.size() == 0);
+        CHECK(input.background_sort_enabled());
+        input.add("again");
+        CHECK(input.to_vector(Order::Ascending) == std::vector<std::string>{"again"});
+    }
+}